@@ -0,0 +1,62 @@
+// std::unordered_map baseline for bench/dict_suite.c, behind the suite's C table interface.
+// build: g++ -O2 -c bench/baseline_unordered_map.cpp -o baseline_unordered_map.o
+// std::hash of an integer is the identity in libstdc++ and libc++; the baseline keeps it, as
+// most users do.
+#include <string>
+#include <unordered_map>
+
+namespace {
+template <class Map> struct Table {
+    Map map;
+    size_t buckets = map.bucket_count();
+    long long rehashes = 0;
+    void count_rehash() {
+        if (map.bucket_count() != buckets) { buckets = map.bucket_count(); rehashes++; }
+    }
+};
+typedef Table<std::unordered_map<unsigned long long, unsigned long long>> U64Table;
+typedef Table<std::unordered_map<std::string, unsigned long long>> StrTable;
+unsigned long long u64_key(const void *key) { return *static_cast<const unsigned long long *>(key); }
+std::string str_key(const void *key, int len) { return std::string(static_cast<const char *>(key), len); }
+}
+
+extern "C" {
+void *umap_u64_create(void) { return new U64Table(); }
+void umap_u64_destroy(void *t) { delete static_cast<U64Table *>(t); }
+long long umap_u64_rehashes(void *t) { return static_cast<U64Table *>(t)->rehashes; }
+void umap_u64_insert(void *t, const void *key, int, unsigned long long val) {
+    U64Table *u = static_cast<U64Table *>(t);
+    u->map.emplace(u64_key(key), val);
+    u->count_rehash();
+}
+bool umap_u64_get(void *t, const void *key, int, unsigned long long *val) {
+    U64Table *u = static_cast<U64Table *>(t);
+    auto it = u->map.find(u64_key(key));
+    if (it == u->map.end()) return false;
+    *val = it->second;
+    return true;
+}
+bool umap_u64_remove(void *t, const void *key, int) {
+    return static_cast<U64Table *>(t)->map.erase(u64_key(key)) != 0;
+}
+
+void *umap_str_create(void) { return new StrTable(); }
+void umap_str_destroy(void *t) { delete static_cast<StrTable *>(t); }
+long long umap_str_rehashes(void *t) { return static_cast<StrTable *>(t)->rehashes; }
+void umap_str_insert(void *t, const void *key, int len, unsigned long long val) {
+    StrTable *u = static_cast<StrTable *>(t);
+    u->map.emplace(str_key(key, len), val);
+    u->count_rehash();
+}
+// find and erase take a std::string, so lookups pay for building one, as they would in most callers
+bool umap_str_get(void *t, const void *key, int len, unsigned long long *val) {
+    StrTable *u = static_cast<StrTable *>(t);
+    auto it = u->map.find(str_key(key, len));
+    if (it == u->map.end()) return false;
+    *val = it->second;
+    return true;
+}
+bool umap_str_remove(void *t, const void *key, int len) {
+    return static_cast<StrTable *>(t)->map.erase(str_key(key, len)) != 0;
+}
+}
@@ -0,0 +1,519 @@
+// Micro benchmarks for C_Dictionary.
+// build: cc -O2 -I. bench/dict_bench.c dict.c dict_concurrent.c dict_snapshot.c lib/darr.c lib/allocator.c -pthread -o dict_bench
+// add -DDICT_SWISS (and -mavx2) or -DDICT_ROBIN_HOOD to measure the other engines, and 
+// -DDICT_INCREMENTAL_GROW to compare growth modes. add -DDICT_THREADS for the threaded build mode.
+// add -DDICT_LARGE for 64-bit indices and hashes.
+// usage: dict_bench [n] [u64|str|churn|latency|batch|concurrent|init|dense|iter|shrink|snapshot|small|upsert|build]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "dict.h"
+#include "dict_concurrent.h"
+#include "dict_snapshot.h"
+
+#define KEY_STR_LEN 32
+
+static double now_ns(void){
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+static unsigned long long rng_state = 0x9e3779b97f4a7c15ull;
+static unsigned long long rng_next(void){ // xorshift64
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+static void shuffle(unsigned long long *a, int n){
+    for (int i = n - 1; i > 0; i--) {
+        int j = (int)(rng_next() % (unsigned long long)(i + 1));
+        unsigned long long t = a[i]; a[i] = a[j]; a[j] = t;
+    }
+}
+// fills 'out' with a KEY_STR_LEN byte string key derived from 'k'
+static void make_str_key(char *out, unsigned long long k){
+    snprintf(out, KEY_STR_LEN + 1, "user:%026llu", k);
+}
+
+// hit and miss latency for 8 byte keys. Every hit pays one key comparison after the hash matches.
+static void bench_u64_keys(int n){
+    unsigned long long *keys = malloc(n * sizeof(*keys));
+    unsigned long long *misses = malloc(n * sizeof(*misses));
+    for (int i = 0; i < n; i++) { keys[i] = rng_next(); misses[i] = rng_next(); }
+    int *d = NULL;
+    double t0 = now_ns();
+    for (int i = 0; i < n; i++) dict_insert(d, &keys[i], i);
+    double t1 = now_ns();
+    shuffle(keys, n);
+    long long sum = 0;
+    double t2 = now_ns();
+    for (int i = 0; i < n; i++) sum += dict_get(d, &keys[i]);
+    double t3 = now_ns();
+    for (int i = 0; i < n; i++) sum += dict_get(d, &misses[i]);
+    double t4 = now_ns();
+    printf("u64 keys    n=%-9d insert %6.1f ns  hit %6.1f ns  miss %6.1f ns  (%lld)\n",
+           n, (t1 - t0) / n, (t3 - t2) / n, (t4 - t3) / n, sum);
+    dict_free(d);
+    free(keys);
+    free(misses);
+}
+// same for 32 byte string keys, which exercise the keystr path and the key arena
+static void bench_str_keys(int n){
+    char *keys = malloc((size_t)n * (KEY_STR_LEN + 1));
+    char *misses = malloc((size_t)n * (KEY_STR_LEN + 1));
+    for (int i = 0; i < n; i++) {
+        make_str_key(keys + (size_t)i * (KEY_STR_LEN + 1), rng_next());
+        make_str_key(misses + (size_t)i * (KEY_STR_LEN + 1), rng_next());
+    }
+    int *d = NULL;
+    double t0 = now_ns();
+    for (int i = 0; i < n; i++) dict_keystr_insert(d, keys + (size_t)i * (KEY_STR_LEN + 1), i, KEY_STR_LEN);
+    double t1 = now_ns();
+    long long sum = 0;
+    double t2 = now_ns();
+    for (int i = 0; i < n; i++) sum += dict_keystr_get(d, keys + (size_t)i * (KEY_STR_LEN + 1), KEY_STR_LEN);
+    double t3 = now_ns();
+    for (int i = 0; i < n; i++) sum += dict_keystr_get(d, misses + (size_t)i * (KEY_STR_LEN + 1), KEY_STR_LEN);
+    double t4 = now_ns();
+    printf("str32 keys  n=%-9d insert %6.1f ns  hit %6.1f ns  miss %6.1f ns  (%lld)\n",
+           n, (t1 - t0) / n, (t3 - t2) / n, (t4 - t3) / n, sum);
+    dict_free(d);
+    free(keys);
+    free(misses);
+}
+
+// steady-state churn: the table holds n keys, and each round deletes the oldest key and inserts a 
+// new one. Tombstones make misses slower until the next rehash; Robin Hood deletion leaves none.
+static void bench_churn(int n){
+    int *d = NULL;
+    unsigned long long *ring = malloc(n * sizeof(*ring));
+    for (int i = 0; i < n; i++) { ring[i] = rng_next(); dict_insert(d, &ring[i], i); }
+    int rounds = 4 * n;
+    long long sum = 0;
+    double t0 = now_ns();
+    for (int i = 0; i < rounds; i++) {
+        int slot = i % n;
+        dict_delete(d, &ring[slot]);
+        ring[slot] = rng_next();
+        dict_insert(d, &ring[slot], i);
+    }
+    double t1 = now_ns();
+    for (int i = 0; i < n; i++) { unsigned long long k = rng_next(); sum += dict_get(d, &k); }
+    double t2 = now_ns();
+    printf("churn       n=%-9d delete+insert %6.1f ns  miss after churn %6.1f ns  (%lld)\n",
+           n, (t1 - t0) / rounds, (t2 - t1) / n, sum);
+    dict_free(d);
+    free(ring);
+}
+
+// dict_get_many against a loop of dict_get, in random key order. Use an n whose table is larger 
+// than the last level cache to see the prefetching at work.
+static void bench_batch(int n){
+    unsigned long long *keys = malloc(n * sizeof(*keys));
+    DictIdx *out = malloc(n * sizeof(*out));
+    for (int i = 0; i < n; i++) keys[i] = rng_next();
+    int *d = NULL;
+    double t0 = now_ns();
+    dict_insert_many(d, keys, (int *)NULL, n, out);
+    double t1 = now_ns();
+    shuffle(keys, n);
+    long long sum = 0;
+    double t2 = now_ns();
+    for (int i = 0; i < n; i++) sum += dict_get(d, &keys[i]);
+    double t3 = now_ns();
+    dict_get_many(d, keys, n, out);
+    double t4 = now_ns();
+    for (int i = 0; i < n; i++) sum -= out[i];
+    printf("batch       n=%-9d insert_many %6.1f ns  get loop %6.1f ns  get_many %6.1f ns  (%lld)\n",
+           n, (t1 - t0) / n, (t3 - t2) / n, (t4 - t3) / n, sum);
+    dict_free(d);
+    free(keys);
+    free(out);
+}
+static int cmp_double(const void *a, const void *b){
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+// per-insert latency while growing from empty to n keys. The tail is dominated by the inserts 
+// that trigger dict__grow; DICT_INCREMENTAL_GROW spreads that rehash over later operations.
+static void bench_insert_latency(int n){
+    int *d = NULL;
+    double *lat = malloc(n * sizeof(*lat));
+    for (int i = 0; i < n; i++) {
+        unsigned long long k = rng_next();
+        double t0 = now_ns();
+        dict_insert(d, &k, i);
+        lat[i] = now_ns() - t0;
+    }
+    qsort(lat, n, sizeof(*lat), cmp_double);
+    printf("insert latency n=%-9d p50 %6.0f ns  p99 %6.0f ns  p99.9 %8.0f ns  max %10.0f ns\n",
+           n, lat[n / 2], lat[(int)(n * 0.99)], lat[(int)(n * 0.999)], lat[n - 1]);
+    // histogram by powers of two
+    int buckets[48] = {0};
+    for (int i = 0; i < n; i++) {
+        int b = 0;
+        while (b < 47 && (double)(1ull << (b + 1)) <= lat[i]) b++;
+        buckets[b]++;
+    }
+    for (int b = 0; b < 48; b++) {
+        if (buckets[b]) printf("  [%10llu ns, %10llu ns) %d\n", 1ull << b, 1ull << (b + 1), buckets[b]);
+    }
+    dict_free(d);
+    free(lat);
+}
+
+// dict_init options: bulk loading into a presized table against growing from empty, and many small 
+// per-request dicts from malloc against an arena that is reset after each round.
+#define SMALL_DICTS 1000
+static void bench_init(int n){
+    unsigned long long *keys = malloc(n * sizeof(*keys));
+    for (int i = 0; i < n; i++) keys[i] = rng_next();
+    int *d = NULL;
+    double t0 = now_ns();
+    for (int i = 0; i < n; i++) dict_insert(d, &keys[i], i);
+    double t1 = now_ns();
+    dict_free(d);
+    dict_init(d, .initial_capacity = n);
+    double t2 = now_ns();
+    for (int i = 0; i < n; i++) dict_insert(d, &keys[i], i);
+    double t3 = now_ns();
+    dict_free(d);
+    printf("init        n=%-9d insert grown %6.1f ns  presized %6.1f ns\n", n, (t1 - t0) / n, (t3 - t2) / n);
+
+    int per_dict = n / SMALL_DICTS > 0 ? n / SMALL_DICTS : 1;
+    int *dicts[SMALL_DICTS];
+    double t4 = now_ns();
+    for (int j = 0; j < SMALL_DICTS; j++) {
+        dicts[j] = NULL;
+        for (int i = 0; i < per_dict; i++) dict_insert(dicts[j], &keys[j * per_dict + i], i);
+    }
+    for (int j = 0; j < SMALL_DICTS; j++) dict_free(dicts[j]);
+    double t5 = now_ns();
+    Arena arena = {0};
+    Allocator alloc = arena_allocator(&arena);
+    double t6 = 0, t7 = 0;
+    for (int round = 0; round < 2; round++) { // the second round reuses the arena's chunks
+        t6 = now_ns();
+        for (int j = 0; j < SMALL_DICTS; j++) {
+            dicts[j] = NULL;
+            dict_init(dicts[j], .allocator = &alloc);
+            for (int i = 0; i < per_dict; i++) dict_insert(dicts[j], &keys[j * per_dict + i], i);
+        }
+        arena_reset(&arena);
+        t7 = now_ns();
+    }
+    arena_free(&arena);
+    printf("init        %d dicts x %d keys  malloc+free %8.1f us  arena+reset %8.1f us\n",
+           SMALL_DICTS, per_dict, (t5 - t4) / 1e3, (t7 - t6) / 1e3);
+    free(keys);
+}
+// scanning every value after deleting half the keys: the default mode leaves holes the caller has to 
+// mark and skip, a dense dict keeps data[0..dict_count) packed.
+static void bench_dense(int n){
+    unsigned long long *keys = malloc(n * sizeof(*keys));
+    for (int i = 0; i < n; i++) keys[i] = rng_next();
+    for (int dense = 0; dense < 2; dense++) {
+        long long *d = NULL;
+        dict_init(d, .dense = dense);
+        for (int i = 0; i < n; i++) dict_insert(d, &keys[i], (long long)i);
+        double t0 = now_ns();
+        for (int i = 0; i < n; i += 2) {
+            DictIdx idx = dict_delete(d, &keys[i]);
+            if (!dense) d[idx] = -1; // mark the hole
+        }
+        double t1 = now_ns();
+        long long sum = 0;
+        int reps = 10;
+        for (int r = 0; r < reps; r++) {
+            if (dense) {
+                for (int i = 0; i < dict_count(d); i++) sum += d[i];
+            } else {
+                for (int i = 0; i < dict_range(d); i++) if (d[i] != -1) sum += d[i];
+            }
+        }
+        double t2 = now_ns();
+        printf("%-11s n=%-9d delete %6.1f ns  scan %6.2f ns per live value  (%lld)\n", dense ? "dense" : "stable",
+               n, (t1 - t0) / (n / 2), (t2 - t1) / reps / dict_count(d), sum);
+        dict_free(d);
+    }
+    free(keys);
+}
+// walking a table after 90% of its keys were deleted: a range scan over marked holes against 
+// dict_foreach, which skips 64 empty slots per bitmap word.
+static void bench_iter(int n){
+    unsigned long long *keys = malloc(n * sizeof(*keys));
+    long long *d = NULL;
+    for (int i = 0; i < n; i++) { keys[i] = rng_next(); dict_insert(d, &keys[i], (long long)i); }
+    for (int i = 0; i < n; i++) if (rng_next() % 10) d[dict_delete(d, &keys[i])] = -1;
+    int reps = 10;
+    long long sum = 0;
+    double t0 = now_ns();
+    for (int r = 0; r < reps; r++)
+        for (int i = 0; i < dict_range(d); i++) if (d[i] != -1) sum += d[i];
+    double t1 = now_ns();
+    for (int r = 0; r < reps; r++)
+        dict_foreach(d, i) sum -= d[i];
+    double t2 = now_ns();
+    printf("iter        n=%-9d live %d  range scan %6.2f ns  dict_foreach %6.2f ns per live value  (%lld)\n",
+           n, (int)dict_count(d), (t1 - t0) / reps / dict_count(d), (t2 - t1) / reps / dict_count(d), sum);
+    dict_free(d);
+    free(keys);
+}
+// bytes held after a burst: fill to n, delete all but 5%, then dict_compact and dict_shrink_to_fit
+static size_t dict_bytes(void *d){
+    DictStats st;
+    dict_stats(d, &st);
+    return st.entries_bytes + st.data_bytes + st.keys_bytes + st.key_arena_bytes + st.free_list_bytes;
+}
+static void bench_shrink(int n){
+    unsigned long long *keys = malloc(n * sizeof(*keys));
+    long long *d = NULL;
+    for (int i = 0; i < n; i++) { keys[i] = rng_next(); dict_insert(d, &keys[i], (long long)i); }
+    for (int i = 0; i < n; i++) if (rng_next() % 20) dict_delete(d, &keys[i]);
+    size_t peak = dict_bytes(d);
+    double t0 = now_ns();
+    DictIdx moved = dict_compact(d, NULL);
+    double t1 = now_ns();
+    dict_shrink_to_fit(d);
+    double t2 = now_ns();
+    printf("shrink      n=%-9d live %d  %.1f MB -> %.1f MB  compact %.2f ms (%d moved)  shrink_to_fit %.2f ms\n",
+           n, (int)dict_count(d), peak / 1e6, dict_bytes(d) / 1e6, (t1 - t0) / 1e6, (int)moved, (t2 - t1) / 1e6);
+    dict_free(d);
+    free(keys);
+}
+// many dicts of 8 keys each: build time, allocator calls and bytes per dict, and lookups spread over 
+// all of them. Compare with -DDICT_SMALL_CAP=0, which starts every dict at INITIAL_CAPACITY.
+static size_t small_allocs;
+static void *small_alloc(void *ctx, size_t size){ (void)ctx; small_allocs++; return malloc(size); }
+static void *small_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size){ (void)ctx; (void)old_size; small_allocs++; return realloc(ptr, new_size); }
+static void small_free(void *ctx, void *ptr, size_t size){ (void)ctx; (void)size; free(ptr); }
+static void bench_small(int n){
+    enum { PER_DICT = 8 };
+    int m = n / PER_DICT;
+    Allocator counting = {small_alloc, small_realloc, small_free, NULL};
+    long long **ds = calloc(m, sizeof(*ds));
+    unsigned long long *keys = malloc((size_t)m * PER_DICT * sizeof(*keys));
+    for (int i = 0; i < m * PER_DICT; i++) keys[i] = rng_next();
+    small_allocs = 0;
+    double t0 = now_ns();
+    for (int j = 0; j < m; j++) {
+        dict_init(ds[j], .allocator = &counting);
+        for (int i = 0; i < PER_DICT; i++) dict_insert(ds[j], &keys[j * PER_DICT + i], (long long)i);
+    }
+    double t1 = now_ns();
+    size_t bytes = 0;
+    for (int j = 0; j < m; j++) bytes += dict_bytes(ds[j]);
+    long long sum = 0;
+    double t2 = now_ns();
+    for (int r = 0; r < m * PER_DICT; r++) {
+        int j = (int)(rng_next() % (unsigned long long)m);
+        sum += ds[j][dict_get(ds[j], &keys[j * PER_DICT + r % PER_DICT])];
+    }
+    double t3 = now_ns();
+    printf("small       dicts=%-9d build %6.1f ns/dict  %.2f allocs/dict  %6.0f bytes/dict  get %6.1f ns  (%lld)\n",
+           m, (t1 - t0) / m, (double)small_allocs / m, (double)bytes / m, (t3 - t2) / (m * PER_DICT), sum);
+    for (int j = 0; j < m; j++) dict_free(ds[j]);
+    free(ds);
+    free(keys);
+}
+// counting occurrences: looking up, inserting on a miss and looking up again, as 
+// dict_get_or_set_default used to, against the single probe of dict_upsert. Keys are drawn from 
+// n/8 distinct ones (mostly hits) and from n (mostly inserts). Each way runs UPSERT_REPS times on a 
+// fresh dict, taking turns on which goes first, and the fastest run of each is reported.
+#define UPSERT_REPS 5
+static double count_get_insert(unsigned long long *keys, int n, int *distinct_out){
+    int *a = NULL;
+    double t0 = now_ns();
+    for (int i = 0; i < n; i++) {
+        int *p = dict_get_ptr(a, &keys[i]);
+        if (!p) {
+            dict_insert(a, &keys[i], 0);
+            p = dict_get_ptr(a, &keys[i]);
+        }
+        (*p)++;
+    }
+    double t = now_ns() - t0;
+    *distinct_out = (int)dict_count(a);
+    dict_free(a);
+    return t / n;
+}
+static double count_upsert(unsigned long long *keys, int n, int *distinct_out){
+    int *b = NULL;
+    double t0 = now_ns();
+    for (int i = 0; i < n; i++) {
+        bool added;
+        DictIdx idx = dict_upsert(b, &keys[i], &added);
+        if (added) b[idx] = 0;
+        b[idx]++;
+    }
+    double t = now_ns() - t0;
+    *distinct_out = (int)dict_count(b);
+    dict_free(b);
+    return t / n;
+}
+static void bench_upsert(int n){
+    unsigned long long *keys = malloc(n * sizeof(*keys));
+    for (int ratio = 8; ratio >= 1; ratio /= 8) {
+        int distinct = n / ratio > 0 ? n / ratio : 1;
+        for (int i = 0; i < n; i++) keys[i] = rng_next() % (unsigned long long)distinct;
+        double best_get = 1e30, best_upsert = 1e30;
+        int count_a = 0, count_b = 0;
+        for (int r = 0; r < UPSERT_REPS; r++) {
+            double g, u;
+            if (r % 2) { u = count_upsert(keys, n, &count_b); g = count_get_insert(keys, n, &count_a); }
+            else { g = count_get_insert(keys, n, &count_a); u = count_upsert(keys, n, &count_b); }
+            if (g < best_get) best_get = g;
+            if (u < best_upsert) best_upsert = u;
+        }
+        if (count_a != count_b) printf("upsert: %d keys against %d\n", count_a, count_b);
+        printf("upsert      n=%-9d distinct=%-9d get+insert+get %6.1f ns  dict_upsert %6.1f ns  (%d keys)\n",
+               n, distinct, best_get, best_upsert, count_b);
+    }
+    free(keys);
+}
+// bulk loading n keys with a dict_insert loop, against dict_build_from_arrays at several thread
+// counts and against inserting into a dict whose rehashes run on worker threads. Without
+// DICT_THREADS every build runs on the calling thread.
+static void bench_build(int n){
+    unsigned long long *keys = malloc(n * sizeof(*keys));
+    int *vals = malloc(n * sizeof(*vals));
+    for (int i = 0; i < n; i++) { keys[i] = rng_next(); vals[i] = i; }
+    int *a = NULL;
+    double t0 = now_ns();
+    for (int i = 0; i < n; i++) dict_insert(a, &keys[i], vals[i]);
+    double t1 = now_ns();
+    printf("build       n=%-9d insert loop %6.1f ns\n", n, (t1 - t0) / n);
+    dict_free(a);
+    for (int threads = 1; threads <= 8; threads *= 2) {
+        int *b = NULL, *c = NULL;
+        double t2 = now_ns();
+        dict_build_from_arrays(b, keys, vals, n, threads);
+        double t3 = now_ns();
+        dict_init(c, .threads = threads);
+        for (int i = 0; i < n; i++) dict_insert(c, &keys[i], vals[i]);
+        double t4 = now_ns();
+        long long sum = 0;
+        for (int i = 0; i < n; i += 64) sum += b[dict_get(b, &keys[i])] - c[dict_get(c, &keys[i])];
+        printf("build       n=%-9d threads=%d build_from_arrays %6.1f ns  insert loop, threaded rehash %6.1f ns  (%lld)\n",
+               n, threads, (t3 - t2) / n, (t4 - t3) / n, sum);
+        dict_free(b);
+        dict_free(c);
+    }
+    free(keys);
+    free(vals);
+}
+// startup cost: rebuilding a dict with dict_insert against mapping a saved snapshot. The open
+// verifies the checksum, which reads the whole file; the first lookup pass then runs on mapped pages.
+static void bench_snapshot(int n){
+    const char *path = "dict_bench.snapshot";
+    unsigned long long *keys = malloc(n * sizeof(*keys));
+    for (int i = 0; i < n; i++) keys[i] = rng_next();
+    long long *d = NULL;
+    double t0 = now_ns();
+    for (int i = 0; i < n; i++) dict_insert(d, &keys[i], (long long)i);
+    double t1 = now_ns();
+    if (!dict_save(d, path)) {
+        printf("snapshot    dict_save failed\n");
+        dict_free(d);
+        free(keys);
+        return;
+    }
+    double t2 = now_ns();
+    dict_free(d);
+    double t3 = now_ns();
+    long long *m = dict_mmap_open(path);
+    double t4 = now_ns();
+    long long sum = 0;
+    for (int i = 0; i < n; i++) sum += m[dict_get(m, &keys[i])];
+    double t5 = now_ns();
+    printf("snapshot    n=%-9d rebuild %8.1f ms  save %8.1f ms  mmap_open %8.1f ms  first get pass %6.1f ns  (%lld)\n",
+           n, (t1 - t0) / 1e6, (t2 - t1) / 1e6, (t4 - t3) / 1e6, (t5 - t4) / n, sum);
+    dict_free(m);
+    remove(path);
+    free(keys);
+}
+// read-mostly throughput of ConcurrentDict: each thread does 95% gets and 5% puts over n keys.
+// Scaling needs as many cores as threads; on fewer cores this shows the cost of oversubscription.
+#define CONCURRENT_OPS 2000000
+typedef struct ConcurrentArgs {
+    ConcurrentDict *cd;
+    const unsigned long long *keys;
+    int n;
+    unsigned long long seed;
+    long long sum;
+} ConcurrentArgs;
+static void *concurrent_worker(void *p){
+    ConcurrentArgs *a = p;
+    unsigned long long s = a->seed;
+    long long sum = 0;
+    for (int i = 0; i < CONCURRENT_OPS; i++) {
+        s ^= s << 13; s ^= s >> 7; s ^= s << 17;
+        const unsigned long long *k = &a->keys[s % (unsigned long long)a->n];
+        if (s % 20 == 0) {
+            int v = i;
+            cdict_put(a->cd, k, &v);
+        } else {
+            int v = 0;
+            cdict_get(a->cd, k, &v);
+            sum += v;
+        }
+    }
+    a->sum = sum;
+    cdict_thread_release();
+    return NULL;
+}
+static void bench_concurrent(int n){
+    unsigned long long *keys = malloc(n * sizeof(*keys));
+    ConcurrentDict *cd = cdict_new(sizeof(int), 0);
+    for (int i = 0; i < n; i++) { keys[i] = rng_next(); cdict_put(cd, &keys[i], &i); }
+    for (int threads = 1; threads <= 32; threads *= 2) {
+        pthread_t tid[32];
+        ConcurrentArgs args[32];
+        double t0 = now_ns();
+        for (int t = 0; t < threads; t++) {
+            args[t] = (ConcurrentArgs){cd, keys, n, rng_next() | 1, 0};
+            pthread_create(&tid[t], NULL, concurrent_worker, &args[t]);
+        }
+        long long sum = 0;
+        for (int t = 0; t < threads; t++) { pthread_join(tid[t], NULL); sum += args[t].sum; }
+        double t1 = now_ns();
+        double ops = (double)threads * CONCURRENT_OPS;
+        printf("concurrent  n=%-9d threads %2d  %7.2f Mops/s  %6.1f ns/op per thread  (%lld)\n",
+               n, threads, ops / (t1 - t0) * 1e3, (t1 - t0) / CONCURRENT_OPS, sum);
+    }
+    cdict_free(cd);
+    free(keys);
+}
+
+int main(int argc, char **argv){
+    int n = argc > 1 ? atoi(argv[1]) : 1000000;
+    const char *only = argc > 2 ? argv[2] : "";
+#if defined(DICT_SWISS)
+    printf("engine: swiss\n");
+#elif defined(DICT_ROBIN_HOOD)
+    printf("engine: robin hood\n");
+#else
+    printf("engine: linear\n");
+#endif
+#if defined(DICT_INCREMENTAL_GROW)
+    printf("growth: incremental\n");
+#endif
+    if (!*only || strcmp(only, "u64") == 0) bench_u64_keys(n);
+    if (!*only || strcmp(only, "str") == 0) bench_str_keys(n);
+    if (!*only || strcmp(only, "churn") == 0) bench_churn(n);
+    if (!*only || strcmp(only, "latency") == 0) bench_insert_latency(n);
+    if (!*only || strcmp(only, "batch") == 0) bench_batch(n);
+    if (!*only || strcmp(only, "concurrent") == 0) bench_concurrent(n);
+    if (!*only || strcmp(only, "init") == 0) bench_init(n);
+    if (!*only || strcmp(only, "dense") == 0) bench_dense(n);
+    if (!*only || strcmp(only, "iter") == 0) bench_iter(n);
+    if (!*only || strcmp(only, "shrink") == 0) bench_shrink(n);
+    if (!*only || strcmp(only, "snapshot") == 0) bench_snapshot(n);
+    if (!*only || strcmp(only, "small") == 0) bench_small(n);
+    if (!*only || strcmp(only, "upsert") == 0) bench_upsert(n);
+    if (!*only || strcmp(only, "build") == 0) bench_build(n);
+    return 0;
+}
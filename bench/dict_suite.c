@@ -0,0 +1,599 @@
+// Workload suite for C_Dictionary, with baselines, for tracking regressions across commits.
+// build: cc -O2 -I. bench/dict_suite.c dict.c lib/darr.c lib/allocator.c -lm -o dict_suite
+// Each baseline is optional and compiled in with a flag; none of them ship with the repo:
+//   std::unordered_map: g++ -O2 -c bench/baseline_unordered_map.cpp -o baseline_unordered_map.o
+//                       and add -DBENCH_STD_UNORDERED_MAP baseline_unordered_map.o -lstdc++
+//   khash (klib):       add -DBENCH_KHASH -I<dir with khash.h>
+//   stb_ds:             add -DBENCH_STB_DS -I<dir with stb_ds.h>
+// Engine flags (-DDICT_SWISS -mavx2, -DDICT_ROBIN_HOOD, -DDICT_INCREMENTAL_GROW, -DDICT_LARGE) apply as usual.
+// usage: dict_suite [--quick] [--sizes 500,50000,...] [--ops n] [--seed s] [--json out.json]
+//
+// Keys and operation streams come from --seed alone, so every table sees the same operations in the
+// same order and a run can be repeated exactly. For stable numbers pin the process to one core
+// (taskset -c 2 ./dict_suite) on an otherwise idle machine with frequency scaling off.
+//
+// Each workload runs twice on a fresh table: once untimed per operation for ns/op, once timing
+// every operation for the percentiles, less the measured cost of reading the clock. Bytes per
+// entry is the growth of the malloc heap divided by the live keys, so it counts everything a table
+// allocates, keys included. Rehashes count rebuilds of the table over its whole life, prefill
+// included.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+#include <malloc.h>
+#include "dict.h"
+
+#define MISS_PCT 10 // of the gets, looking up keys that were never inserted
+#define ZIPF_THETA 0.99 // the YCSB default skew
+#define STR_MIN_LEN 16
+#define STR_MAX_LEN 64
+#define MIN_BUILD_OPS 1000000 // insert workloads rebuild small tables until they have done this many
+
+static const int default_sizes[] = {500, 50000, 1000000, 4000000}; // L1, L2, L3, past the last level cache
+static const int quick_sizes[] = {1000, 100000};
+
+//////////////////////////////
+// keys and operation streams
+//////////////////////////////
+
+static unsigned long long splitmix64(unsigned long long *s){
+    unsigned long long z = (*s += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+static double rng_unit(unsigned long long *s){ return (double)(splitmix64(s) >> 11) * (1.0 / 9007199254740992.0); }
+
+// Zipfian ranks in [0, n) after Gray et al., "Quickly generating billion-record synthetic databases".
+typedef struct Zipf {
+    long long n;
+    double theta, alpha, zetan, eta;
+} Zipf;
+static double zeta(long long n, double theta){
+    double sum = 0;
+    for (long long i = 1; i <= n; i++) sum += 1.0 / pow((double)i, theta);
+    return sum;
+}
+static Zipf zipf_new(long long n, double theta){
+    Zipf z = {n, theta, 1.0 / (1.0 - theta), zeta(n, theta), 0};
+    z.eta = (1.0 - pow(2.0 / (double)n, 1.0 - theta)) / (1.0 - zeta(2, theta) / z.zetan);
+    return z;
+}
+static long long zipf_next(const Zipf *z, unsigned long long *s){
+    double u = rng_unit(s);
+    double uz = u * z->zetan;
+    if (uz < 1.0) return 0;
+    if (uz < 1.0 + pow(0.5, z->theta)) return 1;
+    long long r = (long long)((double)z->n * pow(z->eta * u - z->eta + 1.0, z->alpha));
+    return r < z->n ? r : z->n - 1;
+}
+
+// Every key a workload touches. Keys [0, n) are the prefill, later ones are inserted by the
+// operation stream or only ever looked up (the misses). String keys are NUL terminated for the
+// baselines that need it; their length excludes the NUL.
+typedef struct KeyPool {
+    bool str;
+    int count;
+    unsigned long long *u64;
+    char *bytes;
+    long long *off;
+    int *len;
+} KeyPool;
+static KeyPool pool_new(bool str, int count, unsigned long long *s){
+    KeyPool p = {str, count, NULL, NULL, NULL, NULL};
+    if (!str) {
+        p.u64 = malloc((size_t)count * sizeof(*p.u64));
+        for (int i = 0; i < count; i++) p.u64[i] = splitmix64(s);
+        return p;
+    }
+    p.off = malloc((size_t)count * sizeof(*p.off));
+    p.len = malloc((size_t)count * sizeof(*p.len));
+    long long total = 0;
+    for (int i = 0; i < count; i++) {
+        p.len[i] = STR_MIN_LEN + (int)(splitmix64(s) % (STR_MAX_LEN - STR_MIN_LEN + 1));
+        p.off[i] = total;
+        total += p.len[i] + 1;
+    }
+    p.bytes = malloc((size_t)total);
+    for (int i = 0; i < count; i++) { // a unique 16 digit prefix, then filler that looks like a path
+        char *k = p.bytes + p.off[i];
+        snprintf(k, 17, "%016llx", splitmix64(s));
+        for (int j = 16; j < p.len[i]; j++) k[j] = "abcdefghijklmnopqrstuvwxyz/_-"[splitmix64(s) % 29];
+        k[p.len[i]] = 0;
+    }
+    return p;
+}
+static void pool_free(KeyPool *p){
+    free(p->u64); free(p->bytes); free(p->off); free(p->len);
+}
+static const void *pool_key(const KeyPool *p, int i){ return p->str ? (const void *)(p->bytes + p->off[i]) : (const void *)&p->u64[i]; }
+static int pool_len(const KeyPool *p, int i){ return p->str ? p->len[i] : 8; }
+
+enum { OP_GET, OP_INSERT, OP_DELETE };
+typedef struct Op {
+    int kind;
+    int key; // index into the KeyPool
+} Op;
+
+typedef struct Workload {
+    const char *name;
+    bool str;
+    bool zipf; // gets pick live keys by Zipfian rank instead of uniformly
+    bool build; // start empty and insert n keys; the percentages below are unused
+    int insert_pct, delete_pct; // the rest are gets
+} Workload;
+static const Workload workloads[] = {
+    {"insert_u64",        false, false, true,  0,  0},
+    {"read_u64_uniform",  false, false, false, 5,  0},
+    {"read_u64_zipf",     false, true,  false, 5,  0},
+    {"churn_u64",         false, false, false, 30, 30},
+    {"insert_str",        true,  false, true,  0,  0},
+    {"read_str_zipf",     true,  true,  false, 5,  0},
+    {"churn_str",         true,  false, false, 30, 30},
+};
+
+// The operations of one workload, and the keys they use. 'hits' is the number of gets that should
+// find their key, checked against every table.
+typedef struct Stream {
+    KeyPool pool;
+    int prefill;
+    Op *ops;
+    int op_count;
+    long long hits;
+} Stream;
+static Stream stream_new(const Workload *w, int n, int ops, unsigned long long seed){
+    Stream st = {0};
+    unsigned long long s = seed ^ (unsigned long long)n * 0x2545f4914f6cdd1dull;
+    for (const char *c = w->name; *c; c++) s = s * 31 + (unsigned char)*c;
+    if (w->build) {
+        st.pool = pool_new(w->str, n, &s);
+        st.ops = malloc((size_t)n * sizeof(*st.ops));
+        for (int i = 0; i < n; i++) st.ops[i] = (Op){OP_INSERT, i};
+        st.op_count = n;
+        return st;
+    }
+    int inserts = (int)((long long)ops * w->insert_pct / 100) + 1;
+    int misses = ops / 8 + 1;
+    st.pool = pool_new(w->str, n + inserts + misses, &s);
+    st.prefill = n;
+    st.ops = malloc((size_t)ops * sizeof(*st.ops));
+    int *live = malloc((size_t)(n + inserts) * sizeof(*live)); // pool indices of the keys present
+    int live_count = n, next_new = n, next_miss = n + inserts;
+    for (int i = 0; i < n; i++) live[i] = i;
+    Zipf z = w->zipf ? zipf_new(n, ZIPF_THETA) : (Zipf){0};
+    for (int i = 0; i < ops; i++) {
+        int r = (int)(splitmix64(&s) % 100);
+        if (r < w->insert_pct && next_new < n + inserts) {
+            st.ops[i] = (Op){OP_INSERT, next_new};
+            live[live_count++] = next_new++;
+        } else if (r < w->insert_pct + w->delete_pct && live_count > 1) {
+            int j = (int)(splitmix64(&s) % (unsigned long long)live_count);
+            st.ops[i] = (Op){OP_DELETE, live[j]};
+            live[j] = live[--live_count];
+        } else if ((int)(splitmix64(&s) % 100) < MISS_PCT && next_miss < st.pool.count) {
+            st.ops[i] = (Op){OP_GET, next_miss++};
+        } else {
+            long long j = w->zipf ? zipf_next(&z, &s) : (long long)(splitmix64(&s) % (unsigned long long)live_count);
+            if (j >= live_count) j = j % live_count;
+            st.ops[i] = (Op){OP_GET, live[j]};
+            st.hits++;
+        }
+    }
+    st.op_count = ops;
+    free(live);
+    return st;
+}
+static void stream_free(Stream *st){
+    pool_free(&st->pool);
+    free(st->ops);
+}
+
+//////////////////////////////
+// the tables
+//////////////////////////////
+
+// One table behind function pointers, so every table pays the same call overhead. insert is only
+// given keys that are not present.
+typedef struct Impl {
+    const char *name;
+    bool str;
+    void *(*create)(void);
+    void (*destroy)(void *t);
+    void (*insert)(void *t, const void *key, int len, unsigned long long val);
+    bool (*get)(void *t, const void *key, int len, unsigned long long *val);
+    bool (*remove)(void *t, const void *key, int len);
+    long long (*rehashes)(void *t); // -1: the table doesn't expose it
+} Impl;
+
+typedef struct CDict { unsigned long long *d; } CDict; // the macros reassign d when it grows
+static void *cdict_create(void){ return calloc(1, sizeof(CDict)); }
+static void cdict_destroy(void *t){ CDict *c = t; dict_free(c->d); free(c); }
+static long long cdict_rehashes(void *t){ CDict *c = t; return c->d ? dict__hdr(c->d)->rehashes : 0; }
+static void cdict_insert_u64(void *t, const void *key, int len, unsigned long long val){
+    CDict *c = t; (void)len;
+    dict_insert(c->d, (unsigned long long *)key, val);
+}
+static bool cdict_get_u64(void *t, const void *key, int len, unsigned long long *val){
+    CDict *c = t; (void)len;
+    DictIdx i = dict_get(c->d, (unsigned long long *)key);
+    if (i < 0) return false;
+    *val = c->d[i];
+    return true;
+}
+static bool cdict_remove_u64(void *t, const void *key, int len){
+    CDict *c = t; (void)len;
+    return dict_delete(c->d, (unsigned long long *)key) >= 0;
+}
+static void cdict_insert_str(void *t, const void *key, int len, unsigned long long val){
+    CDict *c = t;
+    dict_keystr_insert(c->d, (char *)key, val, len);
+}
+static bool cdict_get_str(void *t, const void *key, int len, unsigned long long *val){
+    CDict *c = t;
+    DictIdx i = dict_keystr_get(c->d, (char *)key, len);
+    if (i < 0) return false;
+    *val = c->d[i];
+    return true;
+}
+static bool cdict_remove_str(void *t, const void *key, int len){
+    CDict *c = t;
+    return dict_keystr_delete(c->d, (char *)key, len) >= 0;
+}
+
+#if defined(BENCH_STD_UNORDERED_MAP) // bench/baseline_unordered_map.cpp
+void *umap_u64_create(void);
+void umap_u64_destroy(void *t);
+void umap_u64_insert(void *t, const void *key, int len, unsigned long long val);
+bool umap_u64_get(void *t, const void *key, int len, unsigned long long *val);
+bool umap_u64_remove(void *t, const void *key, int len);
+void *umap_str_create(void);
+void umap_str_destroy(void *t);
+void umap_str_insert(void *t, const void *key, int len, unsigned long long val);
+bool umap_str_get(void *t, const void *key, int len, unsigned long long *val);
+bool umap_str_remove(void *t, const void *key, int len);
+long long umap_u64_rehashes(void *t);
+long long umap_str_rehashes(void *t);
+#endif
+
+#if defined(BENCH_KHASH)
+#include "khash.h"
+KHASH_MAP_INIT_INT64(bu64, unsigned long long)
+KHASH_MAP_INIT_STR(bstr, unsigned long long)
+// khash doesn't count rehashes; a change of bucket count is one. Rehashes that only drop deleted
+// buckets keep the count and are missed.
+typedef struct KhU64 { khash_t(bu64) *h; khint_t buckets; long long rehashes; } KhU64;
+typedef struct KhStr { khash_t(bstr) *h; khint_t buckets; long long rehashes; } KhStr;
+static void *kh_u64_create(void){ KhU64 *k = calloc(1, sizeof(*k)); k->h = kh_init(bu64); return k; }
+static void kh_u64_destroy(void *t){ KhU64 *k = t; kh_destroy(bu64, k->h); free(k); }
+static long long kh_u64_rehashes(void *t){ return ((KhU64 *)t)->rehashes; }
+static void kh_u64_insert(void *t, const void *key, int len, unsigned long long val){
+    KhU64 *k = t; (void)len;
+    int ret;
+    khint_t it = kh_put(bu64, k->h, *(const khint64_t *)key, &ret);
+    kh_value(k->h, it) = val;
+    if (kh_n_buckets(k->h) != k->buckets) { k->buckets = kh_n_buckets(k->h); k->rehashes++; }
+}
+static bool kh_u64_get(void *t, const void *key, int len, unsigned long long *val){
+    KhU64 *k = t; (void)len;
+    khint_t it = kh_get(bu64, k->h, *(const khint64_t *)key);
+    if (it == kh_end(k->h)) return false;
+    *val = kh_value(k->h, it);
+    return true;
+}
+static bool kh_u64_remove(void *t, const void *key, int len){
+    KhU64 *k = t; (void)len;
+    khint_t it = kh_get(bu64, k->h, *(const khint64_t *)key);
+    if (it == kh_end(k->h)) return false;
+    kh_del(bu64, k->h, it);
+    return true;
+}
+// khash keeps only the key pointer; the copy makes its memory comparable with tables that own keys
+static void *kh_str_create(void){ KhStr *k = calloc(1, sizeof(*k)); k->h = kh_init(bstr); return k; }
+static void kh_str_destroy(void *t){
+    KhStr *k = t;
+    for (khint_t it = kh_begin(k->h); it != kh_end(k->h); it++) {
+        if (kh_exist(k->h, it)) free((char *)kh_key(k->h, it));
+    }
+    kh_destroy(bstr, k->h);
+    free(k);
+}
+static long long kh_str_rehashes(void *t){ return ((KhStr *)t)->rehashes; }
+static void kh_str_insert(void *t, const void *key, int len, unsigned long long val){
+    KhStr *k = t;
+    int ret;
+    khint_t it = kh_put(bstr, k->h, (const char *)key, &ret);
+    if (ret > 0) {
+        char *copy = malloc((size_t)len + 1);
+        memcpy(copy, key, (size_t)len + 1);
+        kh_key(k->h, it) = copy;
+    }
+    kh_value(k->h, it) = val;
+    if (kh_n_buckets(k->h) != k->buckets) { k->buckets = kh_n_buckets(k->h); k->rehashes++; }
+}
+static bool kh_str_get(void *t, const void *key, int len, unsigned long long *val){
+    KhStr *k = t; (void)len;
+    khint_t it = kh_get(bstr, k->h, (const char *)key);
+    if (it == kh_end(k->h)) return false;
+    *val = kh_value(k->h, it);
+    return true;
+}
+static bool kh_str_remove(void *t, const void *key, int len){
+    KhStr *k = t; (void)len;
+    khint_t it = kh_get(bstr, k->h, (const char *)key);
+    if (it == kh_end(k->h)) return false;
+    free((char *)kh_key(k->h, it));
+    kh_del(bstr, k->h, it);
+    return true;
+}
+#endif
+
+#if defined(BENCH_STB_DS)
+#define STB_DS_IMPLEMENTATION
+#include "stb_ds.h"
+typedef struct StbU64Item { unsigned long long key, value; } StbU64Item;
+typedef struct StbStrItem { char *key; unsigned long long value; } StbStrItem;
+typedef struct StbU64 { StbU64Item *h; } StbU64;
+typedef struct StbStr { StbStrItem *h; } StbStr;
+static void *stb_u64_create(void){ return calloc(1, sizeof(StbU64)); }
+static void stb_u64_destroy(void *t){ StbU64 *s = t; hmfree(s->h); free(s); }
+static long long stb_rehashes(void *t){ (void)t; return -1; }
+static void stb_u64_insert(void *t, const void *key, int len, unsigned long long val){
+    StbU64 *s = t; (void)len;
+    hmput(s->h, *(const unsigned long long *)key, val);
+}
+static bool stb_u64_get(void *t, const void *key, int len, unsigned long long *val){
+    StbU64 *s = t; (void)len;
+    ptrdiff_t i = hmgeti(s->h, *(const unsigned long long *)key);
+    if (i < 0) return false;
+    *val = s->h[i].value;
+    return true;
+}
+static bool stb_u64_remove(void *t, const void *key, int len){
+    StbU64 *s = t; (void)len;
+    return hmdel(s->h, *(const unsigned long long *)key);
+}
+static void *stb_str_create(void){ StbStr *s = calloc(1, sizeof(*s)); sh_new_strdup(s->h); return s; }
+static void stb_str_destroy(void *t){ StbStr *s = t; shfree(s->h); free(s); }
+static void stb_str_insert(void *t, const void *key, int len, unsigned long long val){
+    StbStr *s = t; (void)len;
+    shput(s->h, (char *)key, val);
+}
+static bool stb_str_get(void *t, const void *key, int len, unsigned long long *val){
+    StbStr *s = t; (void)len;
+    ptrdiff_t i = shgeti(s->h, (char *)key);
+    if (i < 0) return false;
+    *val = s->h[i].value;
+    return true;
+}
+static bool stb_str_remove(void *t, const void *key, int len){
+    StbStr *s = t; (void)len;
+    return shdel(s->h, (char *)key);
+}
+#endif
+
+static const Impl impls[] = {
+    {"c_dictionary", false, cdict_create, cdict_destroy, cdict_insert_u64, cdict_get_u64, cdict_remove_u64, cdict_rehashes},
+    {"c_dictionary", true, cdict_create, cdict_destroy, cdict_insert_str, cdict_get_str, cdict_remove_str, cdict_rehashes},
+#if defined(BENCH_STD_UNORDERED_MAP)
+    {"std_unordered_map", false, umap_u64_create, umap_u64_destroy, umap_u64_insert, umap_u64_get, umap_u64_remove, umap_u64_rehashes},
+    {"std_unordered_map", true, umap_str_create, umap_str_destroy, umap_str_insert, umap_str_get, umap_str_remove, umap_str_rehashes},
+#endif
+#if defined(BENCH_KHASH)
+    {"khash", false, kh_u64_create, kh_u64_destroy, kh_u64_insert, kh_u64_get, kh_u64_remove, kh_u64_rehashes},
+    {"khash", true, kh_str_create, kh_str_destroy, kh_str_insert, kh_str_get, kh_str_remove, kh_str_rehashes},
+#endif
+#if defined(BENCH_STB_DS)
+    {"stb_ds", false, stb_u64_create, stb_u64_destroy, stb_u64_insert, stb_u64_get, stb_u64_remove, stb_rehashes},
+    {"stb_ds", true, stb_str_create, stb_str_destroy, stb_str_insert, stb_str_get, stb_str_remove, stb_rehashes},
+#endif
+};
+
+//////////////////////////////
+// measuring
+//////////////////////////////
+
+static double now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+static int cmp_float(const void *a, const void *b){
+    float x = *(const float *)a, y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+// the median cost of one now_ns call, taken off every timed operation
+static double timer_overhead(void){
+    enum { N = 10001 };
+    static float d[N];
+    for (int i = 0; i < N; i++) { double t0 = now_ns(); d[i] = (float)(now_ns() - t0); }
+    qsort(d, N, sizeof(*d), cmp_float);
+    return d[N / 2];
+}
+// bytes the malloc heap holds, mmapped blocks included. -1 where glibc can't say.
+static long long heap_bytes(void){
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 mi = mallinfo2();
+    return (long long)(mi.uordblks + mi.hblkhd);
+#else
+    return -1;
+#endif
+}
+
+typedef struct Result {
+    double ns_per_op, p50, p99, p999, max;
+    double bytes_per_entry; // < 0: unknown
+    long long rehashes; // < 0: unknown
+    long long hits;
+} Result;
+
+// Runs ops[from, to) on t. Timed per operation into 'lat' when it is not NULL.
+static long long run_ops(const Impl *im, void *t, const Stream *st, int from, int to, float *lat, double overhead){
+    long long hits = 0;
+    unsigned long long v;
+    for (int i = from; i < to; i++) {
+        const Op *op = &st->ops[i];
+        const void *key = pool_key(&st->pool, op->key);
+        int len = pool_len(&st->pool, op->key);
+        double t0 = lat ? now_ns() : 0;
+        switch (op->kind) {
+        case OP_GET: hits += im->get(t, key, len, &v); break;
+        case OP_INSERT: im->insert(t, key, len, (unsigned long long)i); break;
+        case OP_DELETE: im->remove(t, key, len); break;
+        }
+        if (lat) {
+            double d = now_ns() - t0 - overhead;
+            lat[i - from] = (float)(d > 0 ? d : 0);
+        }
+    }
+    return hits;
+}
+static void *prefill(const Impl *im, const Stream *st){
+    void *t = im->create();
+    for (int i = 0; i < st->prefill; i++) im->insert(t, pool_key(&st->pool, i), pool_len(&st->pool, i), (unsigned long long)i);
+    return t;
+}
+static Result run_workload(const Workload *w, const Impl *im, const Stream *st, double overhead){
+    Result r = {0};
+    int reps = w->build && st->op_count < MIN_BUILD_OPS ? MIN_BUILD_OPS / st->op_count : 1;
+    long long total_ops = (long long)reps * st->op_count;
+    float *lat = malloc((size_t)total_ops * sizeof(*lat));
+    long long heap0 = 0, heap1 = 0;
+    int live = 0;
+    // throughput pass
+    double elapsed = 0;
+    for (int rep = 0; rep < reps; rep++) {
+        heap0 = heap_bytes();
+        void *t = prefill(im, st);
+        double t0 = now_ns();
+        r.hits = run_ops(im, t, st, 0, st->op_count, NULL, 0);
+        elapsed += now_ns() - t0;
+        heap1 = heap_bytes();
+        r.rehashes = im->rehashes(t);
+        im->destroy(t);
+    }
+    live = st->prefill;
+    for (int i = 0; i < st->op_count; i++) live += (st->ops[i].kind == OP_INSERT) - (st->ops[i].kind == OP_DELETE);
+    r.ns_per_op = elapsed / (double)total_ops;
+    r.bytes_per_entry = heap0 < 0 || live == 0 ? -1 : (double)(heap1 - heap0) / live;
+    // latency pass
+    for (int rep = 0; rep < reps; rep++) {
+        void *t = prefill(im, st);
+        run_ops(im, t, st, 0, st->op_count, lat + (long long)rep * st->op_count, overhead);
+        im->destroy(t);
+    }
+    qsort(lat, (size_t)total_ops, sizeof(*lat), cmp_float);
+    r.p50 = lat[total_ops / 2];
+    r.p99 = lat[(long long)(total_ops * 0.99)];
+    r.p999 = lat[(long long)(total_ops * 0.999)];
+    r.max = lat[total_ops - 1];
+    free(lat);
+    return r;
+}
+
+static const char *engine_name(void){
+#if defined(DICT_SWISS)
+    const char *e = "swiss";
+#elif defined(DICT_ROBIN_HOOD)
+    const char *e = "robin_hood";
+#else
+    const char *e = "linear";
+#endif
+#if defined(DICT_INCREMENTAL_GROW)
+    static char buf[64];
+    snprintf(buf, sizeof(buf), "%s+incremental", e);
+    return buf;
+#else
+    return e;
+#endif
+}
+static void json_number(FILE *f, const char *name, double v, bool last){
+    if (v < 0) fprintf(f, "\"%s\": null%s", name, last ? "" : ", ");
+    else fprintf(f, "\"%s\": %.2f%s", name, v, last ? "" : ", ");
+}
+
+int main(int argc, char **argv){
+    const int *sizes = default_sizes;
+    int size_count = (int)(sizeof(default_sizes) / sizeof(*default_sizes));
+    int parsed[32];
+    int ops = 1000000;
+    unsigned long long seed = 42;
+    const char *json_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            sizes = quick_sizes;
+            size_count = (int)(sizeof(quick_sizes) / sizeof(*quick_sizes));
+            ops = 200000;
+        } else if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc) {
+            size_count = 0;
+            for (char *p = argv[++i]; *p && size_count < 32; ) {
+                parsed[size_count++] = (int)strtol(p, &p, 10);
+                if (*p == ',') p++;
+                else break;
+            }
+            sizes = parsed;
+        } else if (strcmp(argv[i], "--ops") == 0 && i + 1 < argc) {
+            ops = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--quick] [--sizes a,b,...] [--ops n] [--seed s] [--json file]\n", argv[0]);
+            return 2;
+        }
+    }
+    for (int i = 0; i < size_count; i++) {
+        if (sizes[i] < 2) { fprintf(stderr, "sizes must be at least 2\n"); return 2; }
+    }
+    FILE *json = NULL;
+    if (json_path && !(json = fopen(json_path, "w"))) { perror(json_path); return 1; }
+    double overhead = timer_overhead();
+    printf("engine %s  seed %llu  ops %d  timer overhead %.1f ns\n", engine_name(), seed, ops, overhead);
+    printf("%-18s %-18s %9s %8s %8s %8s %9s %10s %8s %8s\n",
+           "workload", "table", "n", "ns/op", "p50", "p99", "p99.9", "max", "B/entry", "rehash");
+    if (json) {
+        fprintf(json, "{\n  \"suite\": \"dict_suite\", \"format\": 1, \"engine\": \"%s\", \"engine_id\": %u, \"seed\": %llu, \"ops\": %d, \"timer_overhead_ns\": %.1f,\n  \"results\": [",
+                engine_name(), dict__engine_id(), seed, ops, overhead);
+    }
+    bool first = true, failed = false;
+    for (size_t wi = 0; wi < sizeof(workloads) / sizeof(*workloads); wi++) {
+        const Workload *w = &workloads[wi];
+        for (int si = 0; si < size_count; si++) {
+            Stream st = stream_new(w, sizes[si], ops, seed);
+            for (size_t ii = 0; ii < sizeof(impls) / sizeof(*impls); ii++) {
+                const Impl *im = &impls[ii];
+                if (im->str != w->str) continue;
+                Result r = run_workload(w, im, &st, overhead);
+                if (r.hits != st.hits) {
+                    fprintf(stderr, "%s %s n=%d: %lld hits, expected %lld\n", w->name, im->name, sizes[si], r.hits, st.hits);
+                    failed = true;
+                }
+                printf("%-18s %-18s %9d %8.1f %8.0f %8.0f %9.0f %10.0f %8.1f %8lld\n",
+                       w->name, im->name, sizes[si], r.ns_per_op, r.p50, r.p99, r.p999, r.max, r.bytes_per_entry, r.rehashes);
+                fflush(stdout);
+                if (json) {
+                    fprintf(json, "%s\n    {\"workload\": \"%s\", \"table\": \"%s\", \"n\": %d, \"ops\": %d, ",
+                            first ? "" : ",", w->name, im->name, sizes[si], st.op_count);
+                    json_number(json, "ns_per_op", r.ns_per_op, false);
+                    json_number(json, "p50_ns", r.p50, false);
+                    json_number(json, "p99_ns", r.p99, false);
+                    json_number(json, "p999_ns", r.p999, false);
+                    json_number(json, "max_ns", r.max, false);
+                    json_number(json, "bytes_per_entry", r.bytes_per_entry, false);
+                    if (r.rehashes < 0) fprintf(json, "\"rehashes\": null}");
+                    else fprintf(json, "\"rehashes\": %lld}", r.rehashes);
+                    first = false;
+                }
+            }
+            stream_free(&st);
+        }
+    }
+    if (json) {
+        fprintf(json, "\n  ]\n}\n");
+        if (fclose(json) != 0) { perror(json_path); return 1; }
+    }
+    return failed ? 1 : 0;
+}
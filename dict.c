@@ -1,16 +1,29 @@
 #include <stdlib.h> 
+#include <stdio.h> 
+#include <stdint.h> 
 #include <string.h> 
 #include <stdbool.h> 
+#include <time.h> 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 #include "lib/darr.h"
 #include "dict.h"
+#if defined(DICT_THREADS)
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#endif
 
 #define stmnt(s) do { s } while (0)
 #define assert_break() (*(int*)0 = 0)
 #define assert(x) stmnt(if (!(x)) { assert_break(); })
 
-#define EMPTY 0xffffffffui32 //UINT32_MAX maybe use -1 now that I've switched to ints.
-#define DELETED (0xffffffffui32 - 1)
-#define KEY_ALREADY_EXISTS (0xffffffffui32 - 2)
+#define EMPTY -1 // entries are memset to 0xff
+#define DELETED -2
+#define KEY_ALREADY_EXISTS -3
 #define offset_of(type, member) ((size_t) &(((type *)0)->member))
 
 // void *dict_malloc(size_t num_bytes) {
@@ -22,17 +35,17 @@
 //     return ptr;
 // }
 
-DictHdr *dict__hdr(void *d){
-    return (DictHdr *)( (char *)d - offset_of(DictHdr, data) - *((char*)d - 1) ) ;
-}
+_Static_assert((INITIAL_CAPACITY & (INITIAL_CAPACITY - 1)) == 0, "INITIAL_CAPACITY must be a power of two");
 
-static int dict__murmer_hash_2 ( const void *key, size_t len, int seed ) {
-    const int m = 0x5bd1e995;
+// The original MurmurHash2. Exposed so a dict can opt back into it with dict_init(d, .hash_fn = dict_hash_murmur2).
+DictHash dict_hash_murmur2 ( const void *key, size_t len, unsigned long long seed ) {
+    const unsigned int m = 0x5bd1e995;
     const int r = 24;
-    int h = seed ^ (int)len;
+    unsigned int h = (unsigned int)seed ^ (unsigned int)len;
     const unsigned char *data = (const unsigned char *)key;
     while(len >= 4) {
-        int k = *(int*)data;
+        unsigned int k;
+        memcpy(&k, data, 4);
         k *= m;
         k ^= k >> r;
         k *= m;
@@ -44,8 +57,8 @@ static int dict__murmer_hash_2 ( const void *key, size_t len, int seed ) {
         len -= 4;
     }
     switch(len) {
-        case 3: h ^= data[2] << 16;
-        case 2: h ^= data[1] << 8;
+        case 3: h ^= data[2] << 16; // fall through
+        case 2: h ^= data[1] << 8;  // fall through
         case 1: h ^= data[0];
         h *= m;
     };
@@ -55,149 +68,1295 @@ static int dict__murmer_hash_2 ( const void *key, size_t len, int seed ) {
 
     return h;
 } 
-static int dict__generate_hash(void *key, size_t key_size) {
-    return dict__murmer_hash_2(key, key_size, 5381);
+
+// wyhash (final version 4, by Wang Yi, public domain) for keys that are not 4, 8 or 16 bytes. 
+// It reads 16 bytes per multiply instead of MurmurHash2's 4.
+static inline unsigned long long dict__wymix(unsigned long long a, unsigned long long b){
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)a * b;
+    return (unsigned long long)r ^ (unsigned long long)(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long long hi, lo = _umul128(a, b, &hi);
+    return lo ^ hi;
+#else
+    unsigned long long ha = a >> 32, hb = b >> 32, la = (unsigned int)a, lb = (unsigned int)b;
+    unsigned long long rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32);
+    unsigned long long c = t < rl;
+    unsigned long long lo = t + (rm1 << 32);
+    c += lo < t;
+    unsigned long long hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    return lo ^ hi;
+#endif
+}
+static inline unsigned long long dict__wyr8(const unsigned char *p){ unsigned long long v; memcpy(&v, p, 8); return v; }
+static inline unsigned long long dict__wyr4(const unsigned char *p){ unsigned int v; memcpy(&v, p, 4); return v; }
+static inline unsigned long long dict__wyr3(const unsigned char *p, size_t k){ 
+    return (((unsigned long long)p[0]) << 16) | (((unsigned long long)p[k >> 1]) << 8) | p[k - 1]; 
+}
+DictHash dict__hash_bytes(const void *key, size_t len, unsigned long long seed){
+    static const unsigned long long secret[4] = {0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull};
+    const unsigned char *p = (const unsigned char *)key;
+    unsigned long long a, b;
+    seed ^= dict__wymix(seed ^ secret[0], secret[1]);
+    if(len <= 16){
+        if(len >= 4){
+            a = (dict__wyr4(p) << 32) | dict__wyr4(p + ((len >> 3) << 2));
+            b = (dict__wyr4(p + len - 4) << 32) | dict__wyr4(p + len - 4 - ((len >> 3) << 2));
+        } else if(len > 0){
+            a = dict__wyr3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if(i > 48){
+            unsigned long long see1 = seed, see2 = seed;
+            do {
+                seed = dict__wymix(dict__wyr8(p) ^ secret[1], dict__wyr8(p + 8) ^ seed);
+                see1 = dict__wymix(dict__wyr8(p + 16) ^ secret[2], dict__wyr8(p + 24) ^ see1);
+                see2 = dict__wymix(dict__wyr8(p + 32) ^ secret[3], dict__wyr8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while(i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while(i > 16){
+            seed = dict__wymix(dict__wyr8(p) ^ secret[1], dict__wyr8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = dict__wyr8(p + i - 16);
+        b = dict__wyr8(p + i - 8);
+    }
+    a ^= secret[1];
+    b ^= seed;
+    unsigned long long lo = a * b; // _wymum: fold the 128-bit product into both halves
+    unsigned long long hi = dict__wymix(a, b) ^ lo;
+    return (DictHash)dict__wymix(lo ^ secret[0] ^ len, hi ^ secret[1]);
+}
+#if defined(_MSC_VER)
+#define dict__prefetch(p) _mm_prefetch((const char *)(p), _MM_HINT_T0)
+static inline int dict__ctz(unsigned int m){ unsigned long i; _BitScanForward(&i, m); return (int)i; }
+static inline int dict__ctz64(unsigned long long m){ unsigned long i; _BitScanForward64(&i, m); return (int)i; }
+static inline int dict__msb64(unsigned long long m){ unsigned long i; _BitScanReverse64(&i, m); return (int)i; }
+#else
+#define dict__prefetch(p) __builtin_prefetch(p)
+static inline int dict__ctz(unsigned int m){ return __builtin_ctz(m); }
+static inline int dict__ctz64(unsigned long long m){ return __builtin_ctzll(m); }
+static inline int dict__msb64(unsigned long long m){ return 63 - __builtin_clzll(m); }
+#endif
+// DICT_COUNT(x): evaluates x only in DICT_PROBE_COUNTERS builds, see DictProbeCounters
+#if defined(DICT_PROBE_COUNTERS)
+#define DICT_COUNT(...) (__VA_ARGS__)
+#else
+#define DICT_COUNT(...) ((void)0)
+#endif
+
+// Threads for dict_build_from_arrays and parallel rehashes. dict__run calls fn(ctx, t) for every t 
+// in [0, threads): on threads of their own in DICT_THREADS builds (t = 0 on the caller's), one after 
+// another otherwise. The callers split their work by t, so both give the same result.
+#define DICT_MAX_THREADS 256
+typedef void (*DictTaskFn)(void *ctx, int t);
+#if defined(DICT_THREADS)
+typedef struct DictTask {
+    DictTaskFn fn;
+    void *ctx;
+    int t;
+} DictTask;
+#if defined(_WIN32)
+static DWORD WINAPI dict__task_main(LPVOID p){ DictTask *task = p; task->fn(task->ctx, task->t); return 0; }
+#else
+static void *dict__task_main(void *p){ DictTask *task = p; task->fn(task->ctx, task->t); return NULL; }
+#endif
+#endif
+static void dict__run(int threads, DictTaskFn fn, void *ctx){
+#if defined(DICT_THREADS)
+    DictTask tasks[DICT_MAX_THREADS];
+    bool started[DICT_MAX_THREADS] = {false};
+#if defined(_WIN32)
+    HANDLE handles[DICT_MAX_THREADS];
+#else
+    pthread_t handles[DICT_MAX_THREADS];
+#endif
+    for (int t = 1; t < threads; t++) {
+        tasks[t] = (DictTask){fn, ctx, t};
+#if defined(_WIN32)
+        handles[t] = CreateThread(NULL, 0, dict__task_main, &tasks[t], 0, NULL);
+        started[t] = handles[t] != NULL;
+#else
+        started[t] = pthread_create(&handles[t], NULL, dict__task_main, &tasks[t]) == 0;
+#endif
+        if (!started[t]) fn(ctx, t); // out of threads: do its share here
+    }
+    fn(ctx, 0);
+    for (int t = 1; t < threads; t++) {
+        if (!started[t]) continue;
+#if defined(_WIN32)
+        WaitForSingleObject(handles[t], INFINITE);
+        CloseHandle(handles[t]);
+#else
+        pthread_join(handles[t], NULL);
+#endif
+    }
+#else
+    for (int t = 0; t < threads; t++) fn(ctx, t);
+#endif
+}
+// the number of threads dict__run will use for a request of 'threads'
+static int dict__thread_count(int threads){
+#if defined(DICT_THREADS)
+    return threads < 1 ? 1 : threads > DICT_MAX_THREADS ? DICT_MAX_THREADS : threads;
+#else
+    (void)threads;
+    return 1;
+#endif
+}
+// Splits [0, n) into 'parts' chunks and gives chunk t as [*a, *b). Chunks start at multiples of 64, 
+// so threads setting bits of the occupancy bitmap never share a word.
+static void dict__chunk(DictIdx n, int parts, int t, DictIdx *a, DictIdx *b){
+    long long per = (((long long)n + parts - 1) / parts + 63) & ~63ll;
+    long long lo = per * t, hi = lo + per;
+    *a = (DictIdx)(lo < n ? lo : n);
+    *b = (DictIdx)(hi < n ? hi : n);
+}
+// Sizes are checked before they are used: a table that would pass DICT_MAX_CAP slots, or an array 
+// whose size in bytes would wrap around, ends the program like a failed allocation instead of 
+// quietly getting a smaller block.
+static void dict__too_large(const char *what){
+    fprintf(stderr, "dict: %s too large\n", what);
+    exit(1);
+}
+// 'n' elements of 'size' bytes. At most half the address space, which leaves room for headers.
+static size_t dict__bytes(DictIdx n, size_t size){
+    if (n < 0 || (size && (size_t)n > (SIZE_MAX / 2) / size)) dict__too_large("allocation");
+    return (size_t)n * size;
+}
+
+// Fibonacci hashing: multiply by 2^DICT_HASH_BITS/phi (DICT_FIBONACCI) and keep the top bits. 
+// Replaces hash % cap, which cost a division on every probe. The multiply also spreads hashes whose 
+// low bits are poorly mixed.
+static inline DictIdx dict__home_slot(DictHash hash, int shift){
+    return (DictIdx)((hash * DICT_FIBONACCI) >> shift);
+}
+static int dict__shift_for_cap(DictIdx cap){
+    int shift = DICT_HASH_BITS;
+    while (cap > 1) { cap >>= 1; shift--; }
+    return shift;
+}
+// Function: dict__key_matches
+// Description: Compares the key stored for data slot 'data_index' with 'key'. Only called after the 
+//              hashes match, so a miss almost never touches the key arena.
+static bool dict__key_matches(DictHdr *d, DictIdx data_index, void *key, size_t key_size){
+    DictKey *k = &d->keys[data_index];
+    return k->len == (DictIdx)key_size && (key_size == 0 || memcmp(d->key_arena + k->offset, key, key_size) == 0);
+}
+// Small dicts, see DICT_SMALL_CAP. The arrays of a small dict sit after data[] in the block of the 
+// header, in this order: entries, key records, one bitmap word, then the free list and key arena 
+// darrs, each 16 byte aligned. None of them is freed or reallocated on its own. The entries are 
+// kept packed in entries[0..len), so a lookup scans only the live keys, comparing hashes first. A 
+// delete moves the last entry into the hole; inserts append.
+#define DICT_SMALL_DARR_BYTES(cap, elem_size) ((offsetof(DarrHdr, arr) + (size_t)(cap) * (elem_size) + 16 + 15) & ~(size_t)15)
+#define DICT_SMALL_BYTES (16 + DICT_SMALL_CAP * (sizeof(DictEntry) + sizeof(DictKey)) + 16 \
+                          + DICT_SMALL_DARR_BYTES(DICT_SMALL_CAP, sizeof(DictIdx)) + DICT_SMALL_DARR_BYTES(DICT_SMALL_KEY_BYTES, 1))
+#if DICT_SMALL_CAP
+_Static_assert(DICT_SMALL_CAP <= 32 && (DICT_SMALL_CAP & (DICT_SMALL_CAP - 1)) == 0, "DICT_SMALL_CAP must be a power of two up to 32");
+_Static_assert(DICT_SMALL_CAP < INITIAL_CAPACITY, "DICT_SMALL_CAP must be below INITIAL_CAPACITY");
+#endif
+static bool dict__in_block(DictHdr *d, const void *p){
+    return (const char *)p >= (const char *)d && (const char *)p < (const char *)d + d->alloc_size;
+}
+// a darr header at *p with room for 'cap' elements, aligned as darr__init would
+static void *dict__small_darr(char **p, int cap, size_t elem_size){
+    DarrHdr *h = (DarrHdr *)*p;
+    *h = (DarrHdr){.len = 0, .cap = cap, .growth_factor = 2, .min_size = (size_t)cap, .allocator = NULL,
+                   .size = offsetof(DarrHdr, arr) + (size_t)cap * elem_size + 16};
+    char padding = (char)((16 - ((uintptr_t)h->arr & 15)) & 15);
+    char *arr = h->arr + padding;
+    *(arr - 1) = padding;
+    *p += DICT_SMALL_DARR_BYTES(cap, elem_size);
+    return arr;
+}
+// Points the arrays of a new small dict into its block, after data[].
+static void dict__small_layout(DictHdr *d, char *data, size_t elem_size){
+    char *p = data + DICT_SMALL_CAP * elem_size;
+    p += (16 - ((uintptr_t)p & 15)) & 15;
+    d->entries = (DictEntry *)p;
+    memset(d->entries, 0xff, DICT_SMALL_CAP * sizeof(DictEntry));
+    p += DICT_SMALL_CAP * sizeof(DictEntry);
+    d->keys = (DictKey *)p;
+    memset(d->keys, 0, DICT_SMALL_CAP * sizeof(DictKey));
+    p += DICT_SMALL_CAP * sizeof(DictKey);
+    if (!d->dense) {
+        d->live = (unsigned long long *)p;
+        *d->live = 0;
+    }
+    p += 16;
+    d->free_list = dict__small_darr(&p, DICT_SMALL_CAP, sizeof(DictIdx));
+    d->key_arena = dict__small_darr(&p, DICT_SMALL_KEY_BYTES, 1);
+    d->cap = DICT_SMALL_CAP;
+    d->shift = dict__shift_for_cap(DICT_SMALL_CAP);
+    d->grow_at = DICT_SMALL_CAP; // a scan needs no EMPTY slot to stop at
+    d->elem_size = elem_size;
+    d->small = true;
+}
+// Copies the bytes of the live keys of a small dict to a new arena on the heap, with room for 'extra' 
+// more. Called when the arena is full: a small dict is never rehashed, so this is also where the 
+// bytes of deleted keys are dropped.
+static void dict__small_rebuild_arena(DictHdr *d, DictIdx extra){
+    unsigned int used = 0; // data indices that hold a key
+    DictIdx live_bytes = 0;
+    for (DictIdx i = 0; i < DICT_SMALL_CAP; i++) {
+        DictIdx data_index = d->entries[i].data_index;
+        if (data_index < 0) continue;
+        used |= 1u << data_index;
+        live_bytes += d->keys[data_index].len;
+    }
+    DictIdx cap = 2 * (live_bytes + extra);
+    char *arena = NULL;
+    darr_init_alloc(arena, cap > 2 * DICT_SMALL_KEY_BYTES ? cap : 2 * DICT_SMALL_KEY_BYTES, 0, d->allocator);
+    for (DictIdx i = 0; i < DICT_SMALL_CAP; i++) {
+        DictKey *k = &d->keys[i];
+        if (!(used >> i & 1)) {
+            *k = (DictKey){0};
+            continue;
+        }
+        memcpy(arena + darr_len(arena), d->key_arena + k->offset, k->len);
+        k->offset = darr_len(arena);
+        k->cap = k->len;
+        darr__hdr(arena)->len += k->len;
+    }
+    if (!dict__in_block(d, d->key_arena)) darr_free(d->key_arena);
+    d->key_arena = arena;
+}
+// Moves every array of a small dict out of its block, leaving an ordinary dict of DICT_SMALL_CAP 
+// slots for dict__grow to rehash. Arrays outside the block (a mapped snapshot's) go back to the 
+// allocator.
+static void dict__unpack_small(DictHdr *d){
+    const Allocator *a = d->allocator;
+    DictEntry *entries = allocator_alloc(a, DICT_SMALL_CAP * sizeof(DictEntry));
+    memcpy(entries, d->entries, DICT_SMALL_CAP * sizeof(DictEntry));
+    if (!dict__in_block(d, d->entries)) allocator_free(a, d->entries, DICT_SMALL_CAP * sizeof(DictEntry));
+    d->entries = entries;
+    DictKey *keys = allocator_alloc(a, DICT_SMALL_CAP * sizeof(DictKey));
+    memcpy(keys, d->keys, DICT_SMALL_CAP * sizeof(DictKey));
+    if (!dict__in_block(d, d->keys)) allocator_free(a, d->keys, DICT_SMALL_CAP * sizeof(DictKey));
+    d->keys = keys;
+    if (d->live) {
+        unsigned long long *live = allocator_alloc(a, 8);
+        *live = *d->live;
+        if (!dict__in_block(d, d->live)) allocator_free(a, d->live, 8);
+        d->live = live;
+    }
+    if (dict__in_block(d, d->free_list)) {
+        DictIdx *free_list = NULL;
+        darr_init_alloc(free_list, DICT_SMALL_CAP, 0, a);
+        memcpy(free_list, d->free_list, darr_len(d->free_list) * sizeof(DictIdx));
+        darr__hdr(free_list)->len = darr_len(d->free_list);
+        d->free_list = free_list;
+    }
+    if (dict__in_block(d, d->key_arena)) dict__small_rebuild_arena(d, 0);
+    d->small = false;
+}
+static DictIdx dict__small_scan(DictHdr *d, void *key, size_t key_size, DictHash hash){
+    for (DictIdx i = 0; i < d->len; i++) {
+        if (d->entries[i].hash == hash && dict__key_matches(d, d->entries[i].data_index, key, key_size)) return i;
+    }
+    return -1;
+}
+// dict__get_entry_index for small dicts
+static DictIdx dict__small_find(DictHdr *d, void *key, size_t key_size, DictHash hash){
+    DICT_COUNT(d->probes.lookups++);
+    DICT_COUNT(d->probes.lookup_probes++);
+    return dict__small_scan(d, key, key_size, hash);
+}
+// dict__find_insert_slot for small dicts: the slot after the last entry, unless the key is already there
+static DictIdx dict__small_insert_slot(DictHdr *d, void *key, size_t key_size, DictHash hash){
+    DICT_COUNT(d->probes.placements++);
+    DICT_COUNT(d->probes.placement_probes++);
+    DictIdx idx = dict__small_scan(d, key, key_size, hash);
+    if (idx != -1) {
+        d->temp_idx = idx;
+        return KEY_ALREADY_EXISTS;
+    }
+    assert(d->len < DICT_SMALL_CAP); // grow_at moves a full small dict to the hashed layout first
+    return d->len;
+}
+// keeps entries[0..len) packed, see above
+static void dict__small_erase(DictHdr *d, DictIdx idx){
+    DictIdx last = d->len - 1;
+    d->entries[idx] = d->entries[last];
+    d->entries[last] = (DictEntry){EMPTY, (DictHash)EMPTY};
+}
+#if defined(DICT_SWISS) && defined(DICT_ROBIN_HOOD)
+#error "DICT_SWISS and DICT_ROBIN_HOOD are separate engines, define only one"
+#endif
+#if defined(DICT_INCREMENTAL_GROW) && (defined(DICT_SWISS) || defined(DICT_ROBIN_HOOD))
+#error "DICT_INCREMENTAL_GROW is only supported by the default linear probing engine"
+#endif
+#if defined(DICT_SWISS)
+// Swiss-table engine. ctrl[] holds one byte per slot: the low 7 bits of the hash for a full slot, or 
+// CTRL_EMPTY / CTRL_DELETED. Slots are probed a group at a time, comparing every control byte of 
+// the group against the tag at once, so a miss usually costs one group load and no entries[] access.
+// entries[].data_index still carries EMPTY/DELETED so the code that walks entries[] is shared.
+#define CTRL_EMPTY ((signed char)-128)
+#define CTRL_DELETED ((signed char)-2)
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define GROUP_WIDTH 32
+static inline unsigned int group_match(const signed char *g, signed char tag){
+    __m256i ctrl = _mm256_loadu_si256((const __m256i *)g);
+    return (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(ctrl, _mm256_set1_epi8(tag)));
+}
+// EMPTY and DELETED are the only control bytes with the sign bit set
+static inline unsigned int group_match_free(const signed char *g){
+    return (unsigned int)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)g));
+}
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GROUP_WIDTH 16
+static inline unsigned int group_match(const signed char *g, signed char tag){
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)g);
+    return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(tag)));
+}
+static inline unsigned int group_match_free(const signed char *g){
+    return (unsigned int)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)g));
+}
+#else // scalar fallback
+#define GROUP_WIDTH 16
+static inline unsigned int group_match(const signed char *g, signed char tag){
+    unsigned int m = 0;
+    for (int i = 0; i < GROUP_WIDTH; i++) m |= (unsigned int)(g[i] == tag) << i;
+    return m;
+}
+static inline unsigned int group_match_free(const signed char *g){
+    unsigned int m = 0;
+    for (int i = 0; i < GROUP_WIDTH; i++) m |= (unsigned int)(g[i] < 0) << i;
+    return m;
+}
+#endif
+_Static_assert(INITIAL_CAPACITY % GROUP_WIDTH == 0, "INITIAL_CAPACITY must be a multiple of GROUP_WIDTH");
+
+static inline unsigned int group_match_empty(const signed char *g){ return group_match(g, CTRL_EMPTY); }
+// the tag uses the low bits, the home slot the high bits of the multiplied hash
+static inline signed char dict__ctrl_tag(DictHash hash){ return (signed char)(hash & 0x7f); }
+static inline DictIdx dict__home_group(DictHash hash, int shift){ return dict__home_slot(hash, shift) / GROUP_WIDTH; }
+
+// Finds a free slot for a hash that is known to be unique, used when rehashing.
+static DictIdx dict__find_empty_slot(DictHdr *d, signed char *ctrl, DictHash hash, DictIdx capacity, int shift){
+    (void)d; // used only by DICT_COUNT
+    DictIdx group_mask = capacity / GROUP_WIDTH - 1;
+    DictIdx g = dict__home_group(hash, shift);
+    DICT_COUNT(d->probes.placements++);
+    // triangular probing over groups visits every group when the group count is a power of two
+    for (DictIdx step = 1; ; step++) {
+        DICT_COUNT(d->probes.placement_probes++);
+        unsigned int free_slots = group_match_free(ctrl + g * GROUP_WIDTH);
+        if (free_slots) return g * GROUP_WIDTH + dict__ctz(free_slots);
+        assert(step <= group_mask + 1); // unreachable
+        g = (g + step) & group_mask;
+    }
+}
+// Finds the slot a new key should go in. Probing stops at the first group with an EMPTY slot; 
+// the first free slot seen on the way is used. Returns KEY_ALREADY_EXISTS with the key's slot in 
+// temp_idx if it is present.
+static DictIdx dict__find_insert_slot(DictHdr *d, DictHash hash, void *key, size_t key_size){
+    DictIdx group_mask = d->cap / GROUP_WIDTH - 1;
+    DictIdx g = dict__home_group(hash, d->shift);
+    signed char tag = dict__ctrl_tag(hash);
+    DictIdx first_free = -1;
+    for (DictIdx step = 1; step <= group_mask + 1; step++) {
+        const signed char *ctrl = d->ctrl + g * GROUP_WIDTH;
+        for (unsigned int m = group_match(ctrl, tag); m; m &= m - 1) {
+            DictIdx idx = g * GROUP_WIDTH + dict__ctz(m);
+            if (d->entries[idx].hash == hash && dict__key_matches(d, d->entries[idx].data_index, key, key_size)) {
+                d->temp_idx = idx;
+                return KEY_ALREADY_EXISTS;
+            }
+        }
+        unsigned int free_slots = group_match_free(ctrl);
+        if (first_free == -1 && free_slots) first_free = g * GROUP_WIDTH + dict__ctz(free_slots);
+        if (group_match_empty(ctrl)) break;
+        g = (g + step) & group_mask;
+    }
+    assert(first_free != -1); // the load factor keeps at least one EMPTY slot
+    return first_free;
+}
+// Function: dict__get_entry_index
+// Description: Searches for a key in the dictionary and returns its index if found. Only slots whose 
+//              control byte equals the 7-bit tag are looked at in entries[].
+// Returns:
+//   DictIdx - The index of the entry where the key is found, or -1 if the key is not present.
+static DictIdx dict__get_entry_index(void *dict, void *key, size_t key_size, DictHash hash){
+    if(dict_cap(dict)==0) return -1;
+    DictHdr *d = dict__hdr(dict);
+    if(d->small) return dict__small_find(d, key, key_size, hash);
+    DictIdx group_mask = d->cap / GROUP_WIDTH - 1;
+    DictIdx g = dict__home_group(hash, d->shift);
+    signed char tag = dict__ctrl_tag(hash);
+    DICT_COUNT(d->probes.lookups++);
+    for (DictIdx step = 1; step <= group_mask + 1; step++) {
+        DICT_COUNT(d->probes.lookup_probes++);
+        const signed char *ctrl = d->ctrl + g * GROUP_WIDTH;
+        for (unsigned int m = group_match(ctrl, tag); m; m &= m - 1) {
+            DictIdx idx = g * GROUP_WIDTH + dict__ctz(m);
+            if (d->entries[idx].hash == hash && dict__key_matches(d, d->entries[idx].data_index, key, key_size)) {
+                return idx;
+            }
+        }
+        if (group_match_empty(ctrl)) return -1; // the key would have been placed in this group
+        g = (g + step) & group_mask;
+    }
+    return -1;
+}
+static inline void dict__set_entry(DictHdr *d, DictIdx idx, DictEntry entry){
+    d->entries[idx] = entry;
+    d->ctrl[idx] = dict__ctrl_tag(entry.hash);
+}
+// dict__place_all: places 'entry' in its home group, which lies in the caller's region. Returns the 
+// slot, -1 if the group is full, or KEY_ALREADY_EXISTS. A copy of the key placed earlier is in the 
+// home group too, or was left for the serial pass along with this one.
+static DictIdx dict__region_place(DictHdr *d, DictEntry entry, DictIdx region_end, bool check_dups){
+    (void)region_end; // groups never straddle regions
+    DictIdx g = dict__home_group(entry.hash, d->shift);
+    const signed char *ctrl = d->ctrl + g * GROUP_WIDTH;
+    if (check_dups) {
+        DictKey *k = &d->keys[entry.data_index];
+        for (unsigned int m = group_match(ctrl, dict__ctrl_tag(entry.hash)); m; m &= m - 1) {
+            DictIdx idx = g * GROUP_WIDTH + dict__ctz(m);
+            if (d->entries[idx].hash == entry.hash && dict__key_matches(d, d->entries[idx].data_index, d->key_arena + k->offset, k->len)) {
+                return KEY_ALREADY_EXISTS;
+            }
+        }
+    }
+    unsigned int free_slots = group_match_free(ctrl);
+    if (!free_slots) return -1;
+    DictIdx idx = g * GROUP_WIDTH + dict__ctz(free_slots);
+    dict__set_entry(d, idx, entry);
+    return idx;
+}
+// places an entry known to be new, probing the whole table
+static void dict__place_new(DictHdr *d, DictEntry entry){
+    dict__set_entry(d, dict__find_empty_slot(d, d->ctrl, entry.hash, d->cap, d->shift), entry);
+}
+// a lookup reads the control bytes of the home group first
+static inline void dict__prefetch_home(DictHdr *d, DictHash hash){
+    dict__prefetch(d->ctrl + dict__home_group(hash, d->shift) * GROUP_WIDTH);
+}
+static inline DictIdx dict__first_candidate(DictHdr *d, DictHash hash){
+    DictIdx group_mask = d->cap / GROUP_WIDTH - 1;
+    DictIdx g = dict__home_group(hash, d->shift);
+    signed char tag = dict__ctrl_tag(hash);
+    for (DictIdx step = 1; step <= group_mask + 1; step++) {
+        const signed char *ctrl = d->ctrl + g * GROUP_WIDTH;
+        for (unsigned int m = group_match(ctrl, tag); m; m &= m - 1) {
+            DictIdx idx = g * GROUP_WIDTH + dict__ctz(m);
+            if (d->entries[idx].hash == hash) return idx;
+        }
+        if (group_match_empty(ctrl)) return -1;
+        g = (g + step) & group_mask;
+    }
+    return -1;
+}
+// A slot can go straight back to EMPTY when its group already has an EMPTY slot: probes stop 
+// at that group anyway, so no key further along the sequence becomes unreachable.
+static inline void dict__erase_entry(DictHdr *d, DictIdx idx){
+    if (group_match_empty(d->ctrl + (idx & ~(GROUP_WIDTH - 1)))) {
+        d->ctrl[idx] = CTRL_EMPTY;
+        d->entries[idx].data_index = EMPTY;
+    } else {
+        d->ctrl[idx] = CTRL_DELETED;
+        d->entries[idx].data_index = DELETED;
+        d->tombstones += 1;
+    }
+}
+// For dict_stats: the groups a lookup of the entry at 'idx' examines, at most 'limit'
+static DictIdx dict__hit_probe_len(DictHdr *d, DictIdx idx, DictIdx limit){
+    DictIdx group_mask = d->cap / GROUP_WIDTH - 1;
+    DictIdx g = dict__home_group(d->entries[idx].hash, d->shift);
+    DictIdx len = 1;
+    for (DictIdx step = 1; g != idx / GROUP_WIDTH && len < limit; step++, len++) g = (g + step) & group_mask;
+    return len;
 }
-static int dict__find_empty_slot(DictEntry *entries, int hash, int capacity){
-    int idx = hash % capacity;
-    int j = capacity;
+// the groups a lookup that misses examines, starting from group 'home', at most 'limit'
+static DictIdx dict__miss_probe_len(DictHdr *d, DictIdx home, DictIdx limit){
+    DictIdx group_mask = d->cap / GROUP_WIDTH - 1;
+    DictIdx g = home;
+    DictIdx len = 1;
+    for (DictIdx step = 1; !group_match_empty(d->ctrl + g * GROUP_WIDTH) && len < limit; step++, len++) g = (g + step) & group_mask;
+    return len;
+}
+#define DICT_PROBE_HOMES(d) ((d)->cap / GROUP_WIDTH) // a probe sequence starts at each group
+#elif defined(DICT_ROBIN_HOOD)
+// Robin Hood linear probing. An entry's probe distance (how far it sits past its home slot) is derived 
+// from the stored hash, so entries stay 8 bytes. An insert takes the slot of any entry closer to its 
+// home than the new one, which keeps probe lengths even, and a lookup stops as soon as it meets an 
+// entry closer to home than the distance searched so far. Deletion shifts the following entries 
+// back one slot instead of leaving a DELETED tombstone, so probe lengths don't creep up under churn.
+static inline DictIdx dict__probe_dist(DictHash hash, DictIdx idx, DictIdx mask, int shift){
+    return (idx - dict__home_slot(hash, shift)) & mask;
+}
+// Puts 'entry' at 'idx', 'dist' slots past its home, displacing entries that are closer to their 
+// own home further along. Returns where 'entry' ended up.
+static DictIdx dict__rh_place(DictHdr *d, DictEntry *entries, DictEntry entry, DictIdx idx, DictIdx dist, DictIdx capacity, int shift){
+    (void)d; // used only by DICT_COUNT
+    DictIdx mask = capacity - 1;
+    DictIdx placed = -1;
+    DictIdx j = capacity;
+    DICT_COUNT(d->probes.placements++);
+    while(true){
+        if( j-- == 0) assert(false); // unreachable
+        DICT_COUNT(d->probes.placement_probes++);
+        if(entries[idx].data_index == EMPTY){
+            entries[idx] = entry;
+            return placed == -1 ? idx : placed;
+        }
+        DictIdx slot_dist = dict__probe_dist(entries[idx].hash, idx, mask, shift);
+        if(slot_dist < dist){
+            DictEntry displaced = entries[idx];
+            entries[idx] = entry;
+            entry = displaced;
+            dist = slot_dist;
+            if(placed == -1) placed = idx;
+        }
+        idx = (idx + 1) & mask;
+        dist += 1;
+    }
+}
+// Finds where a new key belongs: the first EMPTY slot, or the first entry closer to its home than 
+// the new key would be. The key can't be stored past that point. Returns KEY_ALREADY_EXISTS with 
+// the key's slot in temp_idx if it is present.
+static DictIdx dict__find_insert_slot(DictHdr *d, DictHash hash, void *key, size_t key_size){
+    DictIdx mask = d->cap - 1;
+    DictIdx idx = dict__home_slot(hash, d->shift);
+    for (DictIdx dist = 0; dist < d->cap; dist++) {
+        DictIdx data_index = d->entries[idx].data_index;
+        if(data_index == EMPTY || dict__probe_dist(d->entries[idx].hash, idx, mask, d->shift) < dist){
+            return idx;
+        }
+        if(d->entries[idx].hash == hash && dict__key_matches(d, data_index, key, key_size)){
+            d->temp_idx = idx;
+            return KEY_ALREADY_EXISTS;
+        }
+        idx = (idx + 1) & mask;
+    }
+    assert(false); // unreachable, the load factor keeps EMPTY slots
+    return -1;
+}
+// Function: dict__get_entry_index
+// Description: Searches for a key in the dictionary and returns its index if found. The search ends 
+//              at an EMPTY slot or at an entry closer to its home than the current probe distance.
+// Returns:
+//   DictIdx - The index of the entry where the key is found, or -1 if the key is not present.
+static DictIdx dict__get_entry_index(void *dict, void *key, size_t key_size, DictHash hash){
+    if(dict_cap(dict)==0) return -1;
+    DictHdr *d = dict__hdr(dict);
+    if(d->small) return dict__small_find(d, key, key_size, hash);
+    DictIdx mask = d->cap - 1;
+    DictIdx idx = dict__home_slot(hash, d->shift);
+    DICT_COUNT(d->probes.lookups++);
+    for (DictIdx dist = 0; dist < d->cap; dist++) {
+        DICT_COUNT(d->probes.lookup_probes++);
+        DictIdx data_index = d->entries[idx].data_index;
+        if(data_index == EMPTY) return -1;
+        if(d->entries[idx].hash == hash && dict__key_matches(d, data_index, key, key_size)) return idx;
+        if(dict__probe_dist(d->entries[idx].hash, idx, mask, d->shift) < dist) return -1;
+        idx = (idx + 1) & mask;
+    }
+    return -1;
+}
+static inline void dict__set_entry(DictHdr *d, DictIdx idx, DictEntry entry){
+    DictIdx dist = dict__probe_dist(entry.hash, idx, d->cap - 1, d->shift);
+    dict__rh_place(d, d->entries, entry, idx, dist, d->cap, d->shift);
+}
+static void dict__place_new(DictHdr *d, DictEntry entry){
+    dict__rh_place(d, d->entries, entry, dict__home_slot(entry.hash, d->shift), 0, d->cap, d->shift);
+}
+// Filling a region in order of home slot with plain linear probing leaves every cluster sorted by 
+// home, which is the order Robin Hood placement keeps. See dict__region_place.
+#define DICT_REGION_SORT 1
+static inline void dict__prefetch_home(DictHdr *d, DictHash hash){
+    dict__prefetch(d->entries + dict__home_slot(hash, d->shift));
+}
+static inline DictIdx dict__first_candidate(DictHdr *d, DictHash hash){
+    DictIdx mask = d->cap - 1;
+    DictIdx idx = dict__home_slot(hash, d->shift);
+    for (DictIdx dist = 0; d->entries[idx].data_index != EMPTY; dist++) {
+        if(d->entries[idx].hash == hash) return idx;
+        if(dict__probe_dist(d->entries[idx].hash, idx, mask, d->shift) < dist) return -1;
+        idx = (idx + 1) & mask;
+    }
+    return -1;
+}
+// Backward shift deletion: pull every following entry that is not in its home slot back by one.
+static inline void dict__erase_entry(DictHdr *d, DictIdx idx){
+    DictIdx mask = d->cap - 1;
+    DictIdx next = (idx + 1) & mask;
+    while(d->entries[next].data_index != EMPTY && dict__probe_dist(d->entries[next].hash, next, mask, d->shift) > 0){
+        d->entries[idx] = d->entries[next];
+        idx = next;
+        next = (next + 1) & mask;
+    }
+    d->entries[idx].data_index = EMPTY;
+}
+// For dict_stats: the slots a lookup of the entry at 'idx' examines, at most 'limit'
+static DictIdx dict__hit_probe_len(DictHdr *d, DictIdx idx, DictIdx limit){
+    DictIdx len = dict__probe_dist(d->entries[idx].hash, idx, d->cap - 1, d->shift) + 1;
+    return len < limit ? len : limit;
+}
+// the slots a lookup that misses examines, starting from slot 'home', at most 'limit'
+static DictIdx dict__miss_probe_len(DictHdr *d, DictIdx home, DictIdx limit){
+    DictIdx mask = d->cap - 1;
+    DictIdx len = 1;
+    for (DictIdx idx = home, dist = 0; len < limit; idx = (idx + 1) & mask, dist++, len++) {
+        if(d->entries[idx].data_index == EMPTY || dict__probe_dist(d->entries[idx].hash, idx, mask, d->shift) < dist) break;
+    }
+    return len;
+}
+#define DICT_PROBE_HOMES(d) ((d)->cap)
+#else // linear probing
+// Finds a slot for a hash that is known to be unique, used when rehashing.
+static DictIdx dict__find_empty_slot(DictHdr *d, DictEntry *entries, DictHash hash, DictIdx capacity, int shift){
+    (void)d; // used only by DICT_COUNT
+    DictIdx mask = capacity - 1;
+    DictIdx idx = dict__home_slot(hash, shift);
+    DictIdx j = capacity;
+    DICT_COUNT(d->probes.placements++);
     while(true){
         if( j-- == 0) assert(false); // unreachable
+        DICT_COUNT(d->probes.placement_probes++);
         if(entries[idx].data_index == EMPTY || entries[idx].data_index == DELETED){
             return idx;
         }
-        if(entries[idx].hash == hash){
+        idx = (idx + 1) & mask;
+    }
+}
+// Finds the slot a new key should go in. The whole cluster is checked for the key before 
+// reusing the first DELETED slot, otherwise a key behind a tombstone could be inserted twice. 
+// Returns KEY_ALREADY_EXISTS with the key's slot in temp_idx if it is present.
+static DictIdx dict__find_insert_slot(DictHdr *d, DictHash hash, void *key, size_t key_size){
+    DictIdx mask = d->cap - 1;
+    DictIdx idx = dict__home_slot(hash, d->shift);
+    DictIdx first_deleted = -1;
+    DictIdx j = d->cap;
+    while(true){
+        if( j-- == 0) break; // every slot is full or DELETED
+        DictIdx data_index = d->entries[idx].data_index;
+        if(data_index == EMPTY){
+            break;
+        }
+        if(data_index == DELETED){
+            if(first_deleted == -1) first_deleted = idx;
+        } else if(d->entries[idx].hash == hash && dict__key_matches(d, data_index, key, key_size)){
+            d->temp_idx = idx;
             return KEY_ALREADY_EXISTS;
         }
-        idx += 1;
-        if(idx >= capacity){
-            idx = 0;
+        idx = (idx + 1) & mask;
+    }
+    return first_deleted != -1 ? first_deleted : idx;
+}
+// Function: dict__probe
+// Description: Searches one entry array for a key. Split out of dict__get_entry_index so 
+//              DICT_INCREMENTAL_GROW can search the old array while it is being migrated.
+// Returns:
+//   DictIdx - The index of the entry where the key is found, or -1 if the key is not present.
+static DictIdx dict__probe(DictHdr *d, DictEntry *entries, DictIdx cap, int shift, DictHash hash, void *key, size_t key_size){
+    DictIdx mask = cap - 1; // cap is a power of two
+    DictIdx idx = dict__home_slot(hash, shift); // Calculate the initial index to start the search in the hash table.
+    DictIdx j = cap; // Counter to ensure the loop doesn't iterate more than the capacity of the dictionary.
+
+    while(true) { // Loop to search for the key in the dictionary.
+        if(j-- == 0) assert(false); // Fail-safe to avoid infinite loops. Should be unreachable if logic is correct.
+        DICT_COUNT(d->probes.lookup_probes++);
+        if(entries[idx].data_index == EMPTY) {  // If the entry is empty, the key is not in the dictionary.
+            return -1;
         }
+        // The hash is the cheap filter; the stored key decides. DELETED slots never match.
+        if(entries[idx].hash == hash && entries[idx].data_index != DELETED 
+           && dict__key_matches(d, entries[idx].data_index, key, key_size)) {
+            return idx;
+        }
+        idx = (idx + 1) & mask; // Move to the next index, wrapping around to the start if necessary.
     }
 }
+#if defined(DICT_INCREMENTAL_GROW)
+static void dict__migrate(DictHdr *d, DictIdx slots);
+// Looks in the old array too while it is being migrated. A key found there is moved over right 
+// away, so callers always get an index into d->entries.
+static DictIdx dict__probe_migrating(DictHdr *d, DictHash hash, void *key, size_t key_size){
+    DictIdx idx = dict__probe(d, d->entries, d->cap, d->shift, hash, key, key_size);
+    if(idx != -1 || !d->old_entries) return idx;
+    DictIdx old_idx = dict__probe(d, d->old_entries, d->old_cap, d->old_shift, hash, key, key_size);
+    if(old_idx == -1) return -1;
+    idx = dict__find_empty_slot(d, d->entries, hash, d->cap, d->shift);
+    if(d->entries[idx].data_index == DELETED) d->tombstones -= 1;
+    d->entries[idx] = d->old_entries[old_idx];
+    d->old_entries[old_idx].data_index = DELETED; // keeps the rest of the old cluster reachable
+    return idx;
+}
+#endif
+// Function: dict__get_entry_index
+// Description: Searches for a key in the dictionary and returns its index if found.
+//              This function is used internally for operations like insertions or deletions.
+// Parameters:
+//   void *dict - Pointer to the dictionary in which to search for the key.
+//   void *key - Pointer to the key to be searched.
+//   size_t key_size - Size of the key.
+// Returns:
+//   DictIdx - The index of the entry where the key is found, or -1 if the key is not present.
+static DictIdx dict__get_entry_index(void *dict, void *key, size_t key_size, DictHash hash){
+    if(dict_cap(dict)==0) return -1; // Check if the dictionary is empty or NULL
+    DictHdr *d = dict__hdr(dict); // Retrieve the header of the dictionary for internal structure access.
+    if(d->small) return dict__small_find(d, key, key_size, hash);
+    DICT_COUNT(d->probes.lookups++);
+#if defined(DICT_INCREMENTAL_GROW)
+    if(d->old_entries){
+        dict__migrate(d, DICT_MIGRATE_STEP);
+        return dict__probe_migrating(d, hash, key, key_size);
+    }
+#endif
+    return dict__probe(d, d->entries, d->cap, d->shift, hash, key, key_size);
+}
+static inline void dict__set_entry(DictHdr *d, DictIdx idx, DictEntry entry){
+    d->entries[idx] = entry;
+}
+static void dict__place_new(DictHdr *d, DictEntry entry){
+    d->entries[dict__find_empty_slot(d, d->entries, entry.hash, d->cap, d->shift)] = entry;
+}
+static inline void dict__prefetch_home(DictHdr *d, DictHash hash){
+    dict__prefetch(d->entries + dict__home_slot(hash, d->shift));
+}
+// First live entry on the probe path whose hash matches, or -1. The batched lookups check its key 
+// later, after prefetching it.
+static inline DictIdx dict__first_candidate(DictHdr *d, DictHash hash){
+    DictIdx mask = d->cap - 1;
+    DictIdx idx = dict__home_slot(hash, d->shift);
+    while(d->entries[idx].data_index != EMPTY){
+        if(d->entries[idx].hash == hash && d->entries[idx].data_index != DELETED) return idx;
+        idx = (idx + 1) & mask;
+    }
+    return -1;
+}
+static inline void dict__erase_entry(DictHdr *d, DictIdx idx){
+    d->entries[idx].data_index = DELETED;
+    d->tombstones += 1;
+}
+// For dict_stats: the slots a lookup of the entry at 'idx' examines, at most 'limit'
+static DictIdx dict__hit_probe_len(DictHdr *d, DictIdx idx, DictIdx limit){
+    DictIdx len = ((idx - dict__home_slot(d->entries[idx].hash, d->shift)) & (d->cap - 1)) + 1;
+    return len < limit ? len : limit;
+}
+// the slots a lookup that misses examines, starting from slot 'home', at most 'limit'
+static DictIdx dict__miss_probe_len(DictHdr *d, DictIdx home, DictIdx limit){
+    DictIdx mask = d->cap - 1;
+    DictIdx len = 1;
+    for (DictIdx idx = home; len < limit && d->entries[idx].data_index != EMPTY; idx = (idx + 1) & mask) len++;
+    return len;
+}
+#define DICT_PROBE_HOMES(d) ((d)->cap)
+#endif // engines
+#if !defined(DICT_SWISS)
+// dict__place_all: places 'entry' at the first EMPTY slot from its home, if that comes before 
+// 'region_end'. Returns the slot, -1 if the probe would leave the region, or KEY_ALREADY_EXISTS. The 
+// table being filled has no DELETED slots, and copies of a key share a home, so a copy placed 
+// earlier lies on the way.
+static DictIdx dict__region_place(DictHdr *d, DictEntry entry, DictIdx region_end, bool check_dups){
+    DictKey *k = &d->keys[entry.data_index];
+    for (DictIdx idx = dict__home_slot(entry.hash, d->shift); idx < region_end; idx++) {
+        DictIdx data_index = d->entries[idx].data_index;
+        if (data_index == EMPTY) {
+            d->entries[idx] = entry;
+            return idx;
+        }
+        if (check_dups && d->entries[idx].hash == entry.hash && dict__key_matches(d, data_index, d->key_arena + k->offset, k->len)) {
+            return KEY_ALREADY_EXISTS;
+        }
+    }
+    return -1;
+}
+#endif
+// Function: dict__engine_id
+// Description: Identifies the table layout this build reads and writes: the probing engine, the 
+//              Swiss group width (it decides which slots a key may land in), incremental growth, and 
+//              the 64-bit entries of DICT_LARGE. 
+//              Saved snapshots are only opened by builds with the same id.
+unsigned int dict__engine_id(void){
+    unsigned int id = 0;
+#if defined(DICT_SWISS)
+    id = 1 | GROUP_WIDTH << 8;
+#elif defined(DICT_ROBIN_HOOD)
+    id = 2;
+#endif
+#if defined(DICT_INCREMENTAL_GROW)
+    id |= 1u << 16;
+#endif
+#if defined(DICT_LARGE)
+    id |= 1u << 17;
+#endif
+    return id;
+}
+// Rebuilds the key arena with only the keys of live values, in data order. Bytes of deleted keys 
+// that were not reused, and of keys that outgrew their slot, pile up otherwise. The records of free 
+// slots are zeroed, since their bytes are dropped. 'key_cap' is the number of key records, which is 
+// already the new capacity during a grow.
+static void dict__compact_keys(DictHdr *d, DictIdx key_cap){
+    char *arena = NULL;
+    darr_init_alloc(arena, 0, 0, d->allocator);
+    darr_fit(arena, d->key_bytes);
+    for (DictIdx i = 0; i < key_cap; i++) {
+        DictKey *k = &d->keys[i];
+        bool live = d->dense ? i < d->len : (d->live[i >> 6] >> (i & 63) & 1);
+        if (!live) {
+            *k = (DictKey){0};
+            continue;
+        }
+        memcpy(arena + darr_len(arena), d->key_arena + k->offset, k->len);
+        *k = (DictKey){darr_len(arena), k->len, k->len};
+        darr__hdr(arena)->len += k->len;
+    }
+    darr_free(d->key_arena);
+    d->key_arena = arena;
+}
+// Copies a key into the arena for data slot 'data_index'. A slot that held a deleted key keeps the 
+// bytes reserved for it (cap), so they are overwritten in place whenever the new key fits, even after 
+// a shorter key used the slot. Records of slots that never held a key, or whose bytes were dropped, 
+// have cap 0.
+static void dict__store_key(DictHdr *d, DictIdx data_index, void *key, size_t key_size){
+    DictKey *k = &d->keys[data_index];
+    if(k->cap < (DictIdx)key_size){
+        if(d->small && darr_len(d->key_arena) + (DictIdx)key_size > darr_cap(d->key_arena)) dict__small_rebuild_arena(d, (DictIdx)key_size);
+        // garbage beyond the live bytes plus a byte per slot: the pass over the records is paid for by 
+        // the appends that made the garbage. The slot isn't live yet, so its record is dropped too. 
+        // This walks data slots rather than entries, so it works in the middle of a migration.
+        if(!d->small && darr_len(d->key_arena) > 2 * (long long)d->key_bytes + d->cap) dict__compact_keys(d, d->cap);
+        if((size_t)darr_len(d->key_arena) + key_size > (size_t)DICT_IDX_MAX) dict__too_large("key arena"); // offsets are DictIdx
+        k->offset = darr_len(d->key_arena);
+        if(key_size){ // a zero length key needs no bytes, and darr_fit(a, 0) leaves a NULL arena alone
+            darr_fit(d->key_arena, k->offset + (DictIdx)key_size);
+            darr__hdr(d->key_arena)->len += (DictIdx)key_size;
+        }
+        k->cap = (DictIdx)key_size;
+    }
+    k->len = (DictIdx)key_size;
+    d->key_bytes += (DictIdx)key_size;
+    if(key_size) memcpy(d->key_arena + k->offset, key, key_size);
+}
+static DictIdx dict__place_all(DictHdr *d, DictEntry *src, DictIdx src_len, bool check_dups, int threads);
+#if defined(DICT_INCREMENTAL_GROW)
+// Moves up to 'slots' slots of the old entry array into the current one, and frees the old array 
+// once every slot has been moved. Moved slots are marked DELETED so clusters stay intact.
+static void dict__migrate(DictHdr *d, DictIdx slots){
+    DictIdx end = d->migrate_pos + slots;
+    if(end > d->old_cap) end = d->old_cap;
+    for(DictIdx i = d->migrate_pos; i < end; i++){
+        DictEntry e = d->old_entries[i];
+        if(e.data_index == EMPTY || e.data_index == DELETED) continue;
+        DictIdx new_index = dict__find_empty_slot(d, d->entries, e.hash, d->cap, d->shift);
+        if(d->entries[new_index].data_index == DELETED) d->tombstones -= 1;
+        d->entries[new_index] = e;
+        d->old_entries[i].data_index = DELETED;
+    }
+    d->migrate_pos = end;
+    if(d->migrate_pos == d->old_cap){
+        allocator_free(d->allocator, d->old_entries, d->old_cap * sizeof(DictEntry));
+        d->old_entries = NULL;
+    }
+}
+// Filling a fresh multi-megabyte array with 0xff faults in every page, which would be a stall of its 
+// own. Once the table is 3/4 of the way to its grow threshold, the next (doubled) array is allocated 
+// and each insert fills DICT_MIGRATE_STEP * 4 slots of it, enough to finish before the grow.
+static void dict__prepare_next_entries(DictHdr *d){
+    if(!d->next_entries){
+        if((long long)(d->len + d->tombstones) * 4 < (long long)d->grow_at * 3) return;
+        d->next_entries = allocator_alloc(d->allocator, dict__bytes(2 * d->cap, sizeof(DictEntry)));
+        d->next_cap = 2 * d->cap;
+        d->next_init = 0;
+    }
+    DictIdx n = d->next_cap - d->next_init;
+    if(n > DICT_MIGRATE_STEP * 4) n = DICT_MIGRATE_STEP * 4;
+    memset(d->next_entries + d->next_init, 0xff, n * sizeof(DictEntry));
+    d->next_init += n;
+}
+// Swaps in an empty entry array and keeps the old one around to be migrated a few slots at a time 
+// by later operations, instead of rehashing everything inside one dict_insert. The key arena is 
+// left to dict__store_key, which compacts it once garbage makes up most of it.
+static void dict__grow_entries(void *dict, DictIdx new_cap, size_t elem_size) {
+    DictHdr *d = dict__hdr(dict);
+    if(d->old_entries) dict__migrate(d, d->old_cap); // a previous migration must finish first
+    size_t new_size = dict__bytes(new_cap, elem_size);
+    DictEntry *new_entries;
+    if(d->next_entries && d->next_cap == new_cap){
+        new_entries = d->next_entries; // already (mostly) filled by dict__prepare_next_entries
+        memset(new_entries + d->next_init, 0xff, (new_cap - d->next_init) * elem_size);
+    } else {
+        if(d->next_entries) allocator_free(d->allocator, d->next_entries, d->next_cap * sizeof(DictEntry)); // prepared for a doubling, but this is a same-size rehash
+        new_entries = allocator_alloc(d->allocator, new_size);
+        memset(new_entries, 0xff, new_size);
+    }
+    d->next_entries = NULL;
+    if (dict_count(dict)) {
+        d->old_entries = d->entries;
+        d->old_cap = d->cap;
+        d->old_shift = d->shift;
+        d->migrate_pos = 0;
+    } else if (d->entries) {
+        allocator_free(d->allocator, d->entries, d->cap * sizeof(DictEntry));
+    }
+    d->entries = new_entries;
+    d->shift = dict__shift_for_cap(new_cap);
+    d->tombstones = 0; // DELETED entries stay behind in the old array
+}
+#else
+// dict__grow_entries for tables of DICT_PARALLEL_REHASH_MIN or more keys in a dict with .threads 
+// set: the new arrays go in first, then dict__place_all fills them from the old entries.
+static void dict__rehash_parallel(DictHdr *d, DictEntry *new_entries, signed char *new_ctrl, DictIdx new_cap){
+    DictEntry *old_entries = d->entries;
+    signed char *old_ctrl = d->ctrl;
+    DictIdx old_cap = d->cap;
+    d->entries = new_entries;
+    d->ctrl = new_ctrl;
+    d->cap = new_cap;
+    d->shift = dict__shift_for_cap(new_cap);
+    d->tombstones = 0;
+    dict__place_all(d, old_entries, old_cap, false, dict__thread_count(d->threads));
+    if (darr_len(d->key_arena) > 2 * (long long)d->key_bytes) dict__compact_keys(d, new_cap);
+    allocator_free(d->allocator, old_entries, old_cap * sizeof(DictEntry));
+    if (old_ctrl) allocator_free(d->allocator, old_ctrl, old_cap);
+}
 // Grows the entry array of the dictionary to accommodate more elements.
-static void dict__grow_entries(void *dict, int new_cap, size_t elem_size) {
+static void dict__grow_entries(void *dict, DictIdx new_cap, size_t elem_size) {
     DictHdr *d = dict__hdr(dict); // Retrieve the dictionary header
-    int new_size = new_cap * (int)elem_size; // Calculate the new size in bytes for the entries
-    DictEntry *new_entries = malloc(new_size); // Allocate new memory for the entries
-    if (!new_entries) {
-        perror("malloc failed");
-        exit(1);
-    }
+    size_t new_size = dict__bytes(new_cap, elem_size); // Calculate the new size in bytes for the entries
+    DictEntry *new_entries = allocator_alloc(d->allocator, new_size); // Allocate new memory for the entries
     memset(new_entries, 0xff, new_size); // Initialize all bits to 1 (used for EMPTY marker)
+#if defined(DICT_SWISS)
+    signed char *new_ctrl = allocator_alloc(d->allocator, new_cap);
+    memset(new_ctrl, CTRL_EMPTY, new_cap);
+#else
+    signed char *new_ctrl = NULL;
+#endif
+    if (dict__thread_count(d->threads) > 1 && dict_count(dict) >= DICT_PARALLEL_REHASH_MIN) {
+        dict__rehash_parallel(d, new_entries, new_ctrl, new_cap);
+        return;
+    }
     // If the dictionary has existing entries, rehash them into the new entry array
+    int new_shift = dict__shift_for_cap(new_cap);
     if (dict_count(dict)) {
-        for (int i = 0; i < d->cap; i++) {
+        for (DictIdx i = 0; i < d->cap; i++) {
             if(d->entries[i].data_index == EMPTY) continue; // Skip empty entries
             if(d->entries[i].data_index == DELETED) continue; // Skip deleted entries
             // Find a new empty slot for the entry and update its position
-            int new_index = dict__find_empty_slot(new_entries, d->entries[i].hash, new_cap);
+#if defined(DICT_SWISS)
+            DictIdx new_index = dict__find_empty_slot(d, new_ctrl, d->entries[i].hash, new_cap, new_shift);
+            new_ctrl[new_index] = dict__ctrl_tag(d->entries[i].hash);
+            new_entries[new_index] = d->entries[i];
+#elif defined(DICT_ROBIN_HOOD)
+            dict__rh_place(d, new_entries, d->entries[i], dict__home_slot(d->entries[i].hash, new_shift), 0, new_cap, new_shift);
+#else
+            DictIdx new_index = dict__find_empty_slot(d, new_entries, d->entries[i].hash, new_cap, new_shift);
             new_entries[new_index] = d->entries[i];
+#endif
         }
+        // only worth it when most of the arena is garbage
+        if (darr_len(d->key_arena) > 2 * (long long)d->key_bytes) dict__compact_keys(d, new_cap);
     }
     // Replace the old entry array with the new one
     if (d->entries) {
-        free(d->entries);
+        allocator_free(d->allocator, d->entries, d->cap * sizeof(DictEntry));
     }
     d->entries = new_entries;
+#if defined(DICT_SWISS)
+    if (d->ctrl) allocator_free(d->allocator, d->ctrl, d->cap);
+    d->ctrl = new_ctrl;
+#endif
+    d->shift = new_shift;
+    d->tombstones = 0; // rehashing drops every DELETED entry
 }
+#endif // DICT_INCREMENTAL_GROW
 
+// Picks the capacity dict__fit grows to. When DELETED entries rather than live ones filled the 
+// table, it is rehashed at the same capacity, which drops the tombstones.
+DictIdx dict__grow_cap(void *dict, DictIdx n){
+    if (!dict || dict__hdr(dict)->small) return INITIAL_CAPACITY;
+    DictIdx cap = dict_cap(dict);
+    if ((long long)n * 2 < dict__hdr(dict)->grow_at) return cap;
+    if (cap >= DICT_MAX_CAP) dict__too_large("table");
+    return 2 * cap;
+}
+// the most live + DELETED entries a table of 'cap' slots holds. At least one slot stays EMPTY, 
+// which ends every probe.
+static DictIdx dict__grow_at(DictIdx cap, float max_load){
+    long long n = (long long)((double)cap * max_load);
+    return n >= cap ? cap - 1 : (DictIdx)n;
+}
+// bytes before data[] needed to align it; stored at data[-1] (the padding field when it is 0)
+static char dict__data_padding(DictHdr *h, int alignment){
+    return (char)((alignment - ((uintptr_t)h->data & (alignment - 1))) & (alignment - 1));
+}
+// Allocates a header with no slots for dict__grow to size, or a small dict of 'elem_size' values. 
+// Validates the dict_init options.
+static void *dict__new(const DictInit *init, bool small, size_t elem_size){
+    float max_load = init->max_load_factor ? init->max_load_factor : (float)DICT_MAX_LOAD_NUM / DICT_MAX_LOAD_DEN;
+    int alignment = init->alignment > 16 ? init->alignment : 16; // never less than malloc gives
+    assert(max_load > 0 && max_load < 1);
+    assert(init->shrink_load_factor >= 0 && init->shrink_load_factor < max_load);
+    assert(alignment <= 128 && (alignment & (alignment - 1)) == 0); // the padding must fit in a char
+    size_t size = offset_of(DictHdr, data) + alignment;
+    if (small) size += DICT_SMALL_CAP * elem_size + DICT_SMALL_BYTES;
+    DictHdr *h = allocator_alloc(init->allocator, size);
+    h->len = 0;
+    h->cap = 0;
+    h->shift = 0;
+    h->temp_idx = EMPTY;
+    h->tombstones = 0;
+    h->free_list = NULL;
+    h->entries = NULL;
+    h->ctrl = NULL;
+    h->old_entries = NULL;
+    h->next_entries = NULL;
+    h->keys = NULL;
+    h->live = NULL;
+    h->key_arena = NULL;
+    h->key_bytes = 0;
+    h->hash_fn = init->hash_fn;
+    h->seed = init->seed ? init->seed : DICT_DEFAULT_SEED;
+    h->grow_at = 0;
+    h->max_load = max_load;
+    h->shrink_at = 0;
+    h->shrink_load = init->shrink_load_factor;
+    h->rehashes = 0;
+    h->threads = init->threads;
+#if defined(DICT_PROBE_COUNTERS)
+    h->probes = (DictProbeCounters){0};
+#endif
+    h->alignment = alignment;
+    h->alloc_size = size;
+    h->allocator = init->allocator;
+    h->elem_size = 0; // set by dict__grow
+    h->dense = init->dense;
+    h->small = false;
+    if (h->allocator && !small) { // darrs would otherwise be created with malloc on first push
+        darr_init_alloc(h->free_list, 0, 0, h->allocator);
+        darr_init_alloc(h->key_arena, 0, 0, h->allocator);
+    }
+    char alignment_padding = dict__data_padding(h, alignment);
+    char *aligned_data = h->data + alignment_padding;
+    *(aligned_data - 1) = alignment_padding;
+    if (small) dict__small_layout(h, aligned_data, elem_size);
+    return aligned_data;
+}
 // Grows the dictionary to a new capacity.
-void *dict__grow(void *dict, int new_cap, size_t elem_size) {
-    int data_cap = new_cap; // The new capacity for data array
-    // Calculate size needed for the new header, accounting for data and alignment padding
-    size_t data_size = offset_of(DictHdr, data) + (data_cap * elem_size) + 16;
-    DictHdr *new_hdr;
-    // Allocate a new header if the dictionary is empty, or resize the existing one
-    if (!dict) {
-        new_hdr = malloc(data_size);
-        if (!new_hdr) {
-            perror("malloc failed");
-            exit(1);
-        }
-        // Initialize the new header
-        new_hdr->len = 0;
-        new_hdr->temp_idx = EMPTY;
-        new_hdr->entries = NULL;
-        new_hdr->free_list = NULL;
-    } else {
-        new_hdr = realloc(dict__hdr(dict), data_size);
-        if (!new_hdr) {
-            perror("realloc failed");
-            exit(1);
+void *dict__grow(void *dict, DictIdx new_cap, size_t elem_size) {
+    assert(new_cap > 0 && (new_cap & (new_cap - 1)) == 0); // the fibonacci home slot needs a power of two
+    if (!dict) dict = dict__new(&(DictInit){0}, false, 0);
+    DictHdr *d = dict__hdr(dict);
+    bool was_small = d->small;
+    if (was_small) dict__unpack_small(d); // before the realloc, which drops the arrays in the block
+    DictIdx old_cap = d->cap;
+    char old_padding = *((char *)dict - 1);
+    if (new_cap < old_cap) { // shrinking: slots past new_cap are all free, see dict__fit_cap
+        DictIdx kept = 0;
+        for (DictIdx i = 0; i < darr_len(d->free_list); i++) {
+            if (d->free_list[i] < new_cap) d->free_list[kept++] = d->free_list[i];
         }
+        if (d->free_list) darr__hdr(d->free_list)->len = kept;
     }
+    DictIdx moved_cap = new_cap < old_cap ? new_cap : old_cap; // data slots that survive
+    DictIdx data_cap = new_cap; // The new capacity for data array
+    // Calculate size needed for the new header, accounting for data and alignment padding
+    size_t data_size = offset_of(DictHdr, data) + dict__bytes(data_cap, elem_size) + d->alignment;
+    DictHdr *new_hdr = allocator_realloc(d->allocator, d, d->alloc_size, data_size);
+    new_hdr->alloc_size = data_size;
 
-    // Calculate and apply alignment padding to the data array
-    char alignment_padding = (16 - ((uintptr_t)new_hdr->data & 15)) & 15; // Align data[]
+    // Calculate and apply alignment padding to the data array. The block may have moved to an 
+    // address with a different alignment, so the data moves with the padding.
+    char alignment_padding = dict__data_padding(new_hdr, new_hdr->alignment);
+    if (alignment_padding != old_padding) {
+        memmove(new_hdr->data + alignment_padding, new_hdr->data + old_padding, (size_t)moved_cap * elem_size);
+    }
     char *aligned_data = new_hdr->data + alignment_padding;
     *(aligned_data - 1) = alignment_padding; // Store the amount of padding
 
+    // One key record per data slot
+    size_t keys_size = dict__bytes(data_cap, sizeof(DictKey));
+    new_hdr->keys = new_hdr->keys ? allocator_realloc(new_hdr->allocator, new_hdr->keys, (size_t)old_cap * sizeof(DictKey), keys_size)
+                                  : allocator_alloc(new_hdr->allocator, keys_size);
+    if (new_cap > old_cap) memset(new_hdr->keys + old_cap, 0, (size_t)(new_cap - old_cap) * sizeof(DictKey));
+    if (!new_hdr->dense) { // one bit per data slot
+        size_t old_words = dict__live_words(old_cap), words = dict__live_words(new_cap);
+        new_hdr->live = new_hdr->live ? allocator_realloc(new_hdr->allocator, new_hdr->live, old_words * 8, words * 8)
+                                      : allocator_alloc(new_hdr->allocator, words * 8);
+        if (words > old_words) memset(new_hdr->live + old_words, 0, (words - old_words) * 8);
+    }
+    new_hdr->elem_size = elem_size;
+
     // Grow the entries to fit into the newly allocated space
+    if (old_cap) new_hdr->rehashes++;
     dict__grow_entries(aligned_data, new_cap, sizeof(DictEntry));
     new_hdr->cap = new_cap;
+#if defined(DICT_INCREMENTAL_GROW)
+    if (was_small && new_hdr->old_entries) dict__migrate(new_hdr, old_cap); // a small dict's entries aren't at their home slots, so probing the old array can't find them
+#endif
+    new_hdr->grow_at = dict__grow_at(new_cap, new_hdr->max_load);
+    new_hdr->shrink_at = new_cap > INITIAL_CAPACITY ? (DictIdx)((double)new_cap * new_hdr->shrink_load) : 0;
     return aligned_data; // Return the aligned data pointer
 }
+// one past the highest data index holding a value; deleted slots above it can be dropped
+static DictIdx dict__used_range(DictHdr *d){
+    if (d->dense) return d->len;
+    for (DictIdx w = (d->len + darr_len(d->free_list) + 63) / 64 - 1; w >= 0; w--) {
+        if (d->live[w]) return w * 64 + dict__msb64(d->live[w]) + 1;
+    }
+    return 0;
+}
+// the smallest capacity that holds 'n' live entries below the grow threshold, and every data 
+// index in use
+static DictIdx dict__fit_cap(DictHdr *d, DictIdx n){
+    DictIdx range = dict__used_range(d);
+    DictIdx cap = INITIAL_CAPACITY;
+    while (cap < range || dict__grow_at(cap, d->max_load) <= n) cap *= 2;
+    return cap;
+}
+// Function: dict__refit
+// Description: Called by dict__fit when 'n' entries don't fit below the grow threshold, or when 'n' 
+//              has dropped below shrink_at. A shrink leaves room for twice the live entries, so a 
+//              table that refills doesn't grow straight back.
+void *dict__refit(void *dict, DictIdx n, size_t elem_size){
+    if (!dict && n < DICT_SMALL_CAP) return dict__new(&(DictInit){0}, true, elem_size);
+    if (dict && n < dict__hdr(dict)->shrink_at) {
+        DictHdr *d = dict__hdr(dict);
+        DictIdx cap = dict__fit_cap(d, 2 * n);
+        if (cap < d->cap) return dict__grow(dict, cap, elem_size);
+        d->shrink_at = 0; // values high in the data array pin the capacity; retried after the next grow
+        if (dict__has_room(dict, n)) return dict;
+    }
+    return dict__grow(dict, dict__grow_cap(dict, n), elem_size);
+}
+// Function: dict__shrink_to_fit
+// Description: Rebuilds the dict at the smallest capacity that holds its live entries and data 
+//              indices. A table that is already that size is only rehashed if it has tombstones, 
+//              but its key arena and free list are always copied down to what is in use.
+void *dict__shrink_to_fit(void *dict, size_t elem_size){
+    if (!dict) return NULL;
+    DictHdr *d = dict__hdr(dict);
+    DictIdx cap = dict__fit_cap(d, d->len);
+    if (cap < d->cap || d->tombstones) dict = dict__grow(dict, cap < d->cap ? cap : d->cap, elem_size);
+    d = dict__hdr(dict);
+    if (!d->small && d->key_arena) dict__compact_keys(d, d->cap); // the rehash compacts only past 2x garbage
+    DictIdx free_len = darr_len(d->free_list);
+    if (darr_cap(d->free_list) > 2 * free_len + 64) { // darrs don't shrink, so copy it to a smaller one
+        DictIdx *free_list = NULL;
+        darr_init_alloc(free_list, free_len, 0, d->allocator);
+        if (free_len) memcpy(free_list, d->free_list, free_len * sizeof(DictIdx));
+        darr__hdr(free_list)->len = free_len;
+        darr_free(d->free_list);
+        d->free_list = free_list;
+    }
+    return dict;
+}
+// Seeds from the clock and from addresses, which ASLR varies per process. Not cryptographic, but 
+// enough that an attacker can't precompute a set of colliding keys.
+static unsigned long long dict__random_seed(void *dict){
+    unsigned long long x = (unsigned long long)time(NULL);
+    x = dict__mix64(x ^ (unsigned long long)clock());
+    x = dict__mix64(x ^ (unsigned long long)(uintptr_t)dict);
+    x = dict__mix64(x ^ (unsigned long long)(uintptr_t)&x);
+    return x ? x : DICT_DEFAULT_SEED;
+}
+// Function: dict__init
+// Description: Allocates an empty dict with the options in 'init'. Used by the dict_init macro.
+void *dict__init(void *dict, const DictInit *init, size_t elem_size){
+    if(dict) assert(0 && "unreachable - dict__init: dict already exists");
+    if (init->initial_capacity < DICT_SMALL_CAP) {
+        dict = dict__new(init, true, elem_size);
+        if(init->random_seed) dict__hdr(dict)->seed = dict__random_seed(dict);
+        return dict;
+    }
+    dict = dict__new(init, false, 0);
+    float max_load = dict__hdr(dict)->max_load;
+    DictIdx cap = INITIAL_CAPACITY;
+    while (dict__grow_at(cap, max_load) <= init->initial_capacity) { // room for initial_capacity keys
+        if (cap >= DICT_MAX_CAP) dict__too_large("table");
+        cap *= 2;
+    }
+    dict = dict__grow(dict, cap, elem_size);
+    if(init->random_seed) dict__hdr(dict)->seed = dict__random_seed(dict);
+    return dict;
+}
 void dict__free(void *dict){
     DictHdr *d = dict__hdr(dict);
     if(d){
-        if(d->entries) {
-            free(d->entries); 
+        const Allocator *a = d->allocator;
+        // a small dict's arrays may be in its block
+        if(d->entries && !dict__in_block(d, d->entries)) {
+            allocator_free(a, d->entries, d->cap * sizeof(DictEntry)); 
         }
-        if(d->free_list) darr_free(d->free_list);
-        free(dict__hdr(dict));
+        if(d->ctrl) allocator_free(a, d->ctrl, d->cap);
+        if(d->old_entries) allocator_free(a, d->old_entries, d->old_cap * sizeof(DictEntry));
+        if(d->next_entries) allocator_free(a, d->next_entries, d->next_cap * sizeof(DictEntry));
+        if(d->keys && !dict__in_block(d, d->keys)) allocator_free(a, d->keys, d->cap * sizeof(DictKey));
+        if(d->live && !dict__in_block(d, d->live)) allocator_free(a, d->live, dict__live_words(d->cap) * 8);
+        if(d->key_arena && !dict__in_block(d, d->key_arena)) darr_free(d->key_arena);
+        if(d->free_list && !dict__in_block(d, d->free_list)) darr_free(d->free_list);
+        allocator_free(a, d, d->alloc_size);
     }
 }
 // clear/reset the dict without freeing memory
 void dict_clear(void *dict){
     if(!dict) return;
     DictHdr *d = dict__hdr(dict);
-    darr_clear(d->entries);
+    memset(d->entries, 0xff, d->cap * sizeof(DictEntry)); // entries is not a darr
+#if defined(DICT_SWISS)
+    if(d->ctrl) memset(d->ctrl, CTRL_EMPTY, d->cap); // small dicts have none
+#endif
+    d->tombstones = 0;
+    if(d->old_entries){
+        allocator_free(d->allocator, d->old_entries, d->old_cap * sizeof(DictEntry));
+        d->old_entries = NULL;
+    }
     darr_clear(d->free_list);
+    darr_clear(d->key_arena);
+    d->key_bytes = 0;
+    memset(d->keys, 0, d->cap * sizeof(DictKey)); // their bytes are gone
+    if(d->live) memset(d->live, 0, dict__live_words(d->cap) * 8);
     d->len = 0;
 }
-bool dict__insert_entry(void *dict, void *key, size_t key_size){ 
+// Function: dict__insert_entry
+// Description: Adds 'key' in a single probe; the caller has made room with dict__fit.
+// Returns:
+//   bool - true if the key was added, false if it was already present. Either way temp_idx is left 
+//          holding the key's data index, so dict_upsert needs no second lookup.
+bool dict__insert_entry(void *dict, void *key, size_t key_size, DictHash hash){ 
     DictHdr *d = dict__hdr(dict);
-    int data_index = dict_count(dict);
-    int hash = dict__generate_hash(key, key_size);
-    int entry_index = dict__find_empty_slot(d->entries, hash, dict_cap(dict));
+#if defined(DICT_INCREMENTAL_GROW)
+    if(!d->small) dict__prepare_next_entries(d);
+    if(d->old_entries){
+        dict__migrate(d, DICT_MIGRATE_STEP);
+        DICT_COUNT(d->probes.lookups += d->old_entries != NULL);
+        DictIdx old_index = d->old_entries ? dict__probe(d, d->old_entries, d->old_cap, d->old_shift, hash, key, key_size) : -1;
+        if(old_index != -1){
+            d->temp_idx = d->old_entries[old_index].data_index;
+            return false;
+        }
+    }
+#endif
+    DictIdx entry_index = d->small ? dict__small_insert_slot(d, key, key_size, hash) : dict__find_insert_slot(d, hash, key, key_size);
     if(entry_index == KEY_ALREADY_EXISTS){
+        d->temp_idx = d->entries[d->temp_idx].data_index;
         return false;
     }
-    d->entries[entry_index] = (DictEntry){data_index, hash};  
     // we use a free list to keep track of empty slots in the data array from deletions. Use those first. 
-    d->temp_idx = darr_len(d->free_list) ? darr_pop(d->free_list) : d->len;
+    DictIdx data_index = darr_len(d->free_list) > 0 ? darr_pop(d->free_list) : d->len;
+    if(d->entries[entry_index].data_index == DELETED) d->tombstones -= 1;
+    if(d->small) d->entries[entry_index] = (DictEntry){data_index, hash};
+    else dict__set_entry(d, entry_index, (DictEntry){data_index, hash});
+    dict__store_key(d, data_index, key, key_size);
+    if(d->live) d->live[data_index >> 6] |= 1ull << (data_index & 63);
+    d->temp_idx = data_index;
     d->len += 1;
     return true;
 }
-// Function: dict__get_entry_index
-// Description: Searches for a key in the dictionary and returns its index if found.
-//              This function is used internally for operations like insertions or deletions.
-// Parameters:
-//   void *dict - Pointer to the dictionary in which to search for the key.
-//   void *key - Pointer to the key to be searched.
-//   size_t key_size - Size of the key.
-// Returns:
-//   int - The index of the entry where the key is found, or -1 if the key is not present.
-static int dict__get_entry_index(void *dict, void *key, size_t key_size){
-    if(dict_cap(dict)==0) return -1; // Check if the dictionary is empty or NULL
-    DictHdr *d = dict__hdr(dict); // Retrieve the header of the dictionary for internal structure access.
-    int hash = dict__generate_hash(key, key_size); // Generate a hash value for the given key.
-    int idx = hash % d->cap; // Calculate the initial index to start the search in the hash table.
-    int j = d->cap; // Counter to ensure the loop doesn't iterate more than the capacity of the dictionary.
-
-    while(true) { // Loop to search for the key in the dictionary.
-        if(j-- == 0) assert(false); // Fail-safe to avoid infinite loops. Should be unreachable if logic is correct.
-        if(d->entries[idx].data_index == EMPTY) {  // If the entry is empty, the key is not in the dictionary.
-            return -1;
-        }
-        if(d->entries[idx].hash == hash) { // If the hash matches, the correct entry has been found.
-            return idx;
-        }
-        idx += 1; // Move to the next index, wrapping around to the start if necessary.
-        if(idx >= d->cap) { idx = 0; } 
-    }
-}
 // Function: dict__find_entry
 // Description: Searches for an entry in the dictionary corresponding to the given key.
 //              If found, stores the index of this entry in a temporary variable within
@@ -208,8 +1367,8 @@ static int dict__get_entry_index(void *dict, void *key, size_t key_size){
 //   size_t key_size - Size of the key.
 // Returns:
 //   bool - True if the entry is found, False otherwise.
-bool dict__find_entry(void *dict, void *key, size_t key_size){
-    int idx = dict__get_entry_index(dict, key, key_size);
+bool dict__find_entry(void *dict, void *key, size_t key_size, DictHash hash){
+    DictIdx idx = dict__get_entry_index(dict, key, key_size, hash);
     if(idx == -1) return false; // entry is not found
 
     DictHdr *d = dict__hdr(dict);
@@ -225,31 +1384,492 @@ bool dict__find_entry(void *dict, void *key, size_t key_size){
 //   void *key - Pointer to the key for which the data index is required.
 //   size_t key_size - Size of the key.
 // Returns:
-//   int - The index of the data associated with the key, or -1 if the key is not found.
-int dict__get(void *dict, void *key, size_t key_size){
-    int idx = dict__get_entry_index(dict, key, key_size);
+//   DictIdx - The index of the data associated with the key, or -1 if the key is not found.
+DictIdx dict__get(void *dict, void *key, size_t key_size, DictHash hash){
+    DictIdx idx = dict__get_entry_index(dict, key, key_size, hash);
     if(idx == -1) return -1;
     DictHdr *d = dict__hdr(dict);
     return d->entries[idx].data_index;
 }
-int dict__delete(void *dict, void *key, size_t key_size){
-    int idx = dict__get_entry_index(dict, key, key_size);
+// Moves the value in data slot 'from' to the unused slot 'to' and points its entry there: the last 
+// value into the hole left by a dense delete, or a tail value into a free slot for dict_compact. The 
+// entry is found by probing for the stored key; entries move around (Robin Hood shifts, rehashing, 
+// migration), so a fixed back-pointer would need updating on every move, while the probe is one 
+// lookup per moved value.
+static void dict__move_value(void *dict, DictIdx from, DictIdx to){
+    DictHdr *d = dict__hdr(dict);
+    DictKey moved = d->keys[from];
+    void *moved_key = d->key_arena + moved.offset;
+    DictIdx idx = dict__get_entry_index(dict, moved_key, moved.len, dict__key_hash(dict, moved_key, moved.len));
+    assert(idx != -1 && d->entries[idx].data_index == from);
+    d->entries[idx].data_index = to;
+    memcpy((char *)dict + (size_t)to * d->elem_size, (char *)dict + (size_t)from * d->elem_size, d->elem_size);
+    // swap the records, so the bytes of the key that used 'to' can be reused by a key stored in 'from'
+    d->keys[from] = d->keys[to];
+    d->keys[to] = moved;
+}
+static void dict__dense_fill(void *dict, DictIdx hole){
+    DictIdx last = dict__hdr(dict)->len; // len is already decremented
+    if(hole != last) dict__move_value(dict, last, hole);
+}
+DictIdx dict__delete(void *dict, void *key, size_t key_size, DictHash hash){
+    DictIdx idx = dict__get_entry_index(dict, key, key_size, hash);
     if(idx == -1) return -1;
     DictHdr *d = dict__hdr(dict);
-    int data_index = d->entries[idx].data_index;
-    d->entries[idx].data_index = DELETED;
-    darr_push(d->free_list, data_index);
+    DictIdx data_index = d->entries[idx].data_index;
+    if(d->small) dict__small_erase(d, idx);
+    else dict__erase_entry(d, idx);
     d->len -= 1; 
+    d->key_bytes -= d->keys[data_index].len;
+    if(d->dense) {
+        dict__dense_fill(dict, data_index);
+    } else {
+        darr_push(d->free_list, data_index);
+        d->live[data_index >> 6] &= ~(1ull << (data_index & 63));
+    }
     // return the data index of the deleted entry. Caller may wish to mark data as invalid
     return data_index;
 }
-int dict_keystr_delete(void *dict, void *key, size_t key_size){
-    return dict__delete(dict, key, key_size);
+// Batched operations. Keys are hashed DICT_BATCH at a time, then the home slot of the key 
+// DICT_PREFETCH_DIST places ahead is prefetched while the current one is probed, so the cache misses 
+// on entries[] for neighbouring keys overlap instead of running back to back.
+#define DICT_BATCH 64
+#define DICT_PREFETCH_DIST 8
+
+// warms the pipeline for the first keys of a batch
+static inline void dict__prefetch_batch(DictHdr *d, DictHash *hashes, DictIdx m){
+    if (d->small) return; // entries[] is in the header block
+    for (DictIdx i = 0; i < m && i < DICT_PREFETCH_DIST; i++) dict__prefetch_home(d, hashes[i]);
+}
+static inline void dict__prefetch_ahead(DictHdr *d, DictHash *hashes, DictIdx m, DictIdx i){
+    if (!d->small && i + DICT_PREFETCH_DIST < m) dict__prefetch_home(d, hashes[i + DICT_PREFETCH_DIST]);
 }
-int dict_keystr_get(void *dict, void *key, size_t key_size){
-    return dict__get(dict, key, key_size);
+static void dict__get_or_delete_many(void *dict, const void *keys, size_t key_size, DictIdx n, DictIdx *out, bool del){
+    const char *k = keys;
+    if(dict_cap(dict) == 0){
+        for (DictIdx i = 0; out && i < n; i++) out[i] = -1;
+        return;
+    }
+    DictHdr *d = dict__hdr(dict);
+    DictHash hashes[DICT_BATCH];
+    for (DictIdx base = 0; base < n; base += DICT_BATCH) {
+        DictIdx m = n - base < DICT_BATCH ? n - base : DICT_BATCH;
+        for (DictIdx i = 0; i < m; i++) hashes[i] = dict__key_hash(dict, k + (base + i) * key_size, key_size);
+        dict__prefetch_batch(d, hashes, m);
+        for (DictIdx i = 0; i < m; i++) {
+            dict__prefetch_ahead(d, hashes, m, i);
+            void *key = (void *)(k + (base + i) * key_size);
+            DictIdx data_index = del ? dict__delete(dict, key, key_size, hashes[i]) : dict__get(dict, key, key_size, hashes[i]);
+            if (out) out[base + i] = data_index;
+        }
+    }
+}
+// Function: dict__get_many
+// Description: Looks up 'n' keys of 'key_size' bytes stored back to back in 'keys'.
+//              A hit costs three dependent misses: entries[], the key record and the key bytes. Each 
+//              batch goes through them one level at a time, prefetching the next level for every key 
+//              before reading it, so the misses of the whole batch overlap.
+//   DictIdx *out - receives the data index of each key, or -1 if it is not present.
+void dict__get_many(void *dict, const void *keys, size_t key_size, DictIdx n, DictIdx *out){
+    if(dict_cap(dict) == 0 || dict__hdr(dict)->old_entries || dict__hdr(dict)->small){ // still migrating or small, keep it simple
+        dict__get_or_delete_many(dict, keys, key_size, n, out, false);
+        return;
+    }
+    DictHdr *d = dict__hdr(dict);
+    const char *k = keys;
+    DictHash hashes[DICT_BATCH];
+    DictIdx cand[DICT_BATCH];
+    for (DictIdx base = 0; base < n; base += DICT_BATCH) {
+        DictIdx m = n - base < DICT_BATCH ? n - base : DICT_BATCH;
+        for (DictIdx i = 0; i < m; i++) {
+            hashes[i] = dict__key_hash(dict, k + (base + i) * key_size, key_size);
+            dict__prefetch_home(d, hashes[i]);
+        }
+        for (DictIdx i = 0; i < m; i++) {
+            cand[i] = dict__first_candidate(d, hashes[i]);
+            if (cand[i] != -1) dict__prefetch(d->keys + d->entries[cand[i]].data_index);
+        }
+        for (DictIdx i = 0; i < m; i++) {
+            if (cand[i] != -1) dict__prefetch(d->key_arena + d->keys[d->entries[cand[i]].data_index].offset);
+        }
+        for (DictIdx i = 0; i < m; i++) {
+            void *key = (void *)(k + (base + i) * key_size);
+            DictIdx data_index = -1;
+            if (cand[i] != -1) {
+                data_index = d->entries[cand[i]].data_index;
+                // a different key with the same hash: rare, let the full probe sort it out
+                if (!dict__key_matches(d, data_index, key, key_size)) data_index = dict__get(dict, key, key_size, hashes[i]);
+            }
+            out[base + i] = data_index;
+        }
+    }
+}
+// Function: dict__delete_many
+// Description: Deletes 'n' keys. 'out' (may be NULL) receives each deleted data index, or -1.
+void dict__delete_many(void *dict, const void *keys, size_t key_size, DictIdx n, DictIdx *out){
+    dict__get_or_delete_many(dict, keys, key_size, n, out, true);
+}
+// Function: dict__insert_many
+// Description: Inserts 'n' keys and copies vals[i] (elem_size bytes each, may be NULL) into the data slot 
+//              of every new key. The table grows once for the whole batch up front.
+//   DictIdx *out - may be NULL, receives each new data index, or -1 when the key was already present.
+// Returns:
+//   void * - the dict, which may have moved.
+void *dict__insert_many(void *dict, const void *keys, size_t key_size, const void *vals, size_t elem_size, DictIdx n, DictIdx *out){
+    while(!dict__has_room(dict, dict_count(dict) + n)){
+        dict = dict__refit(dict, dict_count(dict) + n, elem_size);
+    }
+    DictHdr *d = dict__hdr(dict);
+    const char *k = keys;
+    const char *v = vals;
+    DictHash hashes[DICT_BATCH];
+    for (DictIdx base = 0; base < n; base += DICT_BATCH) {
+        DictIdx m = n - base < DICT_BATCH ? n - base : DICT_BATCH;
+        for (DictIdx i = 0; i < m; i++) hashes[i] = dict__key_hash(dict, k + (base + i) * key_size, key_size);
+        dict__prefetch_batch(d, hashes, m);
+        for (DictIdx i = 0; i < m; i++) {
+            dict__prefetch_ahead(d, hashes, m, i);
+            DictIdx data_index = -1;
+            if (dict__insert_entry(dict, (void *)(k + (base + i) * key_size), key_size, hashes[i])) {
+                data_index = d->temp_idx;
+                if (v) memcpy((char *)dict + data_index * elem_size, v + (base + i) * elem_size, elem_size);
+            }
+            if (out) out[base + i] = data_index;
+        }
+    }
+    return dict;
+}
+DictIdx dict_keystr_delete(void *dict, void *key, size_t key_size){
+    return dict__delete(dict, key, key_size, dict__key_hash(dict, key, key_size));
+}
+DictIdx dict_keystr_get(void *dict, void *key, size_t key_size){
+    return dict__get(dict, key, key_size, dict__key_hash(dict, key, key_size));
 }
 // len of the data array, including invalid entries. For iterating
-int dict_range(void *dict){ 
+DictIdx dict_range(void *dict){ 
     return dict ? dict__hdr(dict)->len + darr_len(dict__hdr(dict)->free_list) : 0; 
+}
+// Function: dict_next_live
+// Description: Finds the first data index at or after 'i' that holds a value. Deleted slots are 
+//              skipped 64 at a time by scanning the occupancy bitmap with count-trailing-zeros, so 
+//              walking a sparse table costs time in proportion to its values, not its range.
+// Returns:
+//   DictIdx - the data index, or -1 when there are no more values.
+DictIdx dict_next_live(void *dict, DictIdx i){
+    DictIdx range = dict_range(dict);
+    if(i >= range) return -1;
+    DictHdr *d = dict__hdr(dict);
+    if(d->dense) return i; // data[0..len) has no holes
+    DictIdx w = i >> 6;
+    DictIdx words = (range + 63) >> 6;
+    unsigned long long bits = d->live[w] & (~0ull << (i & 63));
+    while(!bits){
+        if(++w == words) return -1;
+        bits = d->live[w];
+    }
+    return (w << 6) + dict__ctz64(bits);
 } 
+// Function: dict__foreach_next
+// Description: Steps dict_foreach past 'i'. A dense dict fills a deleted slot with its last value, 
+//              so when the count has dropped since the previous step, slot 'i' is looked at again. 
+//              'count' holds the count seen by the previous step.
+// Returns:
+//   DictIdx - the next data index to visit, or -1.
+DictIdx dict__foreach_next(void *dict, DictIdx i, DictIdx *count){
+    DictIdx len = dict_count(dict);
+    bool revisit = dict && dict__hdr(dict)->dense && len < *count;
+    *count = len;
+    return dict_next_live(dict, revisit ? i : i + 1);
+}
+// Function: dict_stats
+// Description: Reports the size, occupancy, probe length histograms and memory use of the dict. 
+//              Hit lengths come from where each live entry sits relative to its home; miss lengths 
+//              are taken from every possible home, which is where a uniform hash sends absent keys. 
+//              Each probe is followed for at most DICT_PROBE_HIST steps.
+void dict_stats(void *dict, DictStats *out){
+    memset(out, 0, sizeof(*out));
+    if(!dict) return;
+    DictHdr *d = dict__hdr(dict);
+    out->cap = d->cap;
+    out->len = d->len;
+    out->tombstones = d->tombstones;
+    out->free_list_len = darr_len(d->free_list);
+    out->load_factor = d->cap ? (float)(d->len + d->tombstones) / (float)d->cap : 0;
+    out->max_load_factor = d->max_load;
+    out->rehashes = d->rehashes;
+    for(DictIdx i = 0; i < d->cap; i++){
+        DictIdx data_index = d->entries[i].data_index;
+        if(data_index == EMPTY || data_index == DELETED) continue;
+        out->hit_probes[d->small ? 0 : dict__hit_probe_len(d, i, DICT_PROBE_HIST) - 1]++; // a small dict is one scan
+    }
+    if(d->small) out->miss_probes[0] = 1;
+    for(DictIdx home = 0; !d->small && home < DICT_PROBE_HOMES(d); home++){
+        out->miss_probes[dict__miss_probe_len(d, home, DICT_PROBE_HIST) - 1]++;
+    }
+    // the arrays a small dict keeps in its block count as data
+    out->entries_bytes = dict__in_block(d, d->entries) ? 0 : (size_t)d->cap * sizeof(DictEntry);
+    if(d->ctrl) out->entries_bytes += (size_t)d->cap;
+    if(d->old_entries) out->entries_bytes += (size_t)d->old_cap * sizeof(DictEntry);
+    if(d->next_entries) out->entries_bytes += (size_t)d->next_cap * sizeof(DictEntry);
+    out->data_bytes = d->alloc_size;
+    out->keys_bytes = (dict__in_block(d, d->keys) ? 0 : (size_t)d->cap * sizeof(DictKey))
+                    + (d->live && !dict__in_block(d, d->live) ? dict__live_words(d->cap) * 8 : 0);
+    out->key_arena_bytes = d->key_arena && !dict__in_block(d, d->key_arena) ? darr__hdr(d->key_arena)->size : 0;
+    out->free_list_bytes = d->free_list && !dict__in_block(d, d->free_list) ? darr__hdr(d->free_list)->size : 0;
+#if defined(DICT_PROBE_COUNTERS)
+    out->probes = d->probes;
+#endif
+}
+static inline bool dict__is_live(DictHdr *d, DictIdx i){ return (d->live[i >> 6] >> (i & 63)) & 1; }
+// Function: dict_compact
+// Description: Fills the holes below dict_count with the values from the top of the data array, 
+//              lowest hole first and highest value first, so each value moves at most once and 
+//              values below dict_count keep their index. The free list ends up empty.
+// Returns:
+//   DictIdx - the number of values moved.
+DictIdx dict_compact(void *dict, DictIdx *remap){
+    if(!dict) return 0;
+    DictHdr *d = dict__hdr(dict);
+    DictIdx range = dict_range(dict);
+    if(remap){
+        for(DictIdx i = 0; i < range; i++) remap[i] = d->dense || dict__is_live(d, i) ? i : -1;
+    }
+    if(d->dense) return 0; // never has holes
+    DictIdx moved = 0;
+    DictIdx last = range - 1;
+    for(DictIdx hole = 0; hole < d->len; hole++){
+        if(dict__is_live(d, hole)) continue;
+        while(!dict__is_live(d, last)) last--; // a hole below len means a value at or above it
+        dict__move_value(dict, last, hole);
+        d->live[hole >> 6] |= 1ull << (hole & 63);
+        d->live[last >> 6] &= ~(1ull << (last & 63));
+        if(remap) remap[last] = hole;
+        moved++;
+        last--;
+    }
+    darr_clear(d->free_list);
+    return moved;
+}
+// Partitioned builds and rehashes. The table is split into regions of 2^DICT_REGION_BITS slots, and 
+// each entry goes to the region of its home slot. The entries are counted and then scattered into 
+// order[] by region, keeping their order in src, and each thread fills the regions it owns. Entries 
+// only land in their own region, so threads never write the same slot. An entry whose probe would 
+// leave its region is left for a serial pass at the end, which can place it anywhere.
+#define DICT_REGION_BITS 12
+enum { DICT_PLACE_COUNT, DICT_PLACE_SCATTER, DICT_PLACE_FILL };
+typedef struct DictPlace {
+    DictHdr *d;
+    DictEntry *src; // a duplicate key's entry is marked DELETED
+    DictIdx src_len;
+    bool check_dups; // false when the keys are known to differ, as in a rehash
+    int threads;
+    int phase;
+    int region_bits;
+    DictIdx regions;
+    DictIdx *counts; // [threads][regions]: entries of each thread's chunk of src per region, then scatter positions
+    DictIdx *region_start; // [regions + 1], into order[]
+    DictIdx *order; // indices into src, grouped by region
+    DictIdx *deferred; // [regions]: entries at the front of the region's part of order[] left for the serial pass
+    DictIdx *dups; // [threads]
+} DictPlace;
+#if defined(DICT_REGION_SORT)
+// orders a region's entries by home slot, ties in src order. A counting sort on the home slot's 
+// offset in the region; 'scratch' holds 'count' items, 'slots' 2^region_bits + 1 counters.
+static void dict__sort_region(DictPlace *p, DictIdx *items, DictIdx count, DictIdx *scratch, DictIdx *slots){
+    DictIdx mask = ((DictIdx)1 << p->region_bits) - 1;
+    memset(slots, 0, (size_t)(mask + 2) * sizeof(*slots));
+    for (DictIdx j = 0; j < count; j++) slots[(dict__home_slot(p->src[items[j]].hash, p->d->shift) & mask) + 1]++;
+    for (DictIdx i = 0; i <= mask; i++) slots[i + 1] += slots[i];
+    for (DictIdx j = 0; j < count; j++) scratch[slots[dict__home_slot(p->src[items[j]].hash, p->d->shift) & mask]++] = items[j];
+    memcpy(items, scratch, (size_t)count * sizeof(*items));
+}
+#endif
+static void dict__place_task(void *ctx, int t){
+    DictPlace *p = ctx;
+    DictHdr *d = p->d;
+    if (p->phase != DICT_PLACE_FILL) {
+        DictIdx a, b;
+        dict__chunk(p->src_len, p->threads, t, &a, &b);
+        DictIdx *counts = p->counts + (size_t)t * p->regions;
+        for (DictIdx i = a; i < b; i++) {
+            DictEntry e = p->src[i];
+            if (e.data_index < 0) continue; // EMPTY or DELETED in an old entry array
+            DictIdx r = dict__home_slot(e.hash, d->shift) >> p->region_bits;
+            if (p->phase == DICT_PLACE_COUNT) counts[r]++;
+            else p->order[counts[r]++] = i;
+        }
+        return;
+    }
+    DictIdx r0 = (DictIdx)((long long)p->regions * t / p->threads), r1 = (DictIdx)((long long)p->regions * (t + 1) / p->threads);
+#if defined(DICT_REGION_SORT)
+    DictIdx most = 0;
+    for (DictIdx r = r0; r < r1; r++) {
+        if (p->region_start[r + 1] - p->region_start[r] > most) most = p->region_start[r + 1] - p->region_start[r];
+    }
+    size_t scratch_size = ((size_t)most + ((size_t)1 << p->region_bits) + 1) * sizeof(DictIdx);
+    DictIdx *scratch = allocator_alloc(NULL, scratch_size);
+#endif
+    for (DictIdx r = r0; r < r1; r++) {
+        DictIdx *items = p->order + p->region_start[r];
+        DictIdx count = p->region_start[r + 1] - p->region_start[r];
+#if defined(DICT_REGION_SORT)
+        dict__sort_region(p, items, count, scratch, scratch + most);
+#endif
+        DictIdx region_end = (r + 1) << p->region_bits;
+        DictIdx kept = 0;
+        for (DictIdx j = 0; j < count; j++) {
+            DictIdx idx = dict__region_place(d, p->src[items[j]], region_end, p->check_dups);
+            if (idx == -1) {
+                items[kept++] = items[j];
+            } else if (idx == KEY_ALREADY_EXISTS) {
+                p->src[items[j]].data_index = DELETED;
+                p->dups[t]++;
+            }
+        }
+        p->deferred[r] = kept;
+    }
+#if defined(DICT_REGION_SORT)
+    allocator_free(NULL, scratch, scratch_size);
+#endif
+}
+// Function: dict__place_all
+// Description: Places every live entry of 'src' in the empty table of 'd', with 'threads' threads. 
+//              With check_dups, entries whose key was already placed are marked DELETED in src 
+//              instead; the first copy in src order wins.
+// Returns:
+//   DictIdx - the number of duplicates.
+static DictIdx dict__place_all(DictHdr *d, DictEntry *src, DictIdx src_len, bool check_dups, int threads){
+    int cap_bits = DICT_HASH_BITS - d->shift;
+    DictPlace p = {.d = d, .src = src, .src_len = src_len, .check_dups = check_dups, .threads = threads};
+    p.region_bits = cap_bits < DICT_REGION_BITS ? cap_bits : DICT_REGION_BITS;
+    p.regions = d->cap >> p.region_bits;
+    size_t counts_size = (size_t)threads * p.regions * sizeof(DictIdx);
+    p.counts = allocator_alloc(NULL, counts_size);
+    memset(p.counts, 0, counts_size);
+    p.region_start = allocator_alloc(NULL, (p.regions + 1) * sizeof(DictIdx));
+    p.deferred = allocator_alloc(NULL, p.regions * sizeof(DictIdx));
+    p.dups = allocator_alloc(NULL, threads * sizeof(DictIdx));
+    memset(p.dups, 0, threads * sizeof(DictIdx));
+    p.phase = DICT_PLACE_COUNT;
+    dict__run(threads, dict__place_task, &p);
+    // regions in order, and within a region the chunks of src in order
+    DictIdx pos = 0;
+    for (DictIdx r = 0; r < p.regions; r++) {
+        p.region_start[r] = pos;
+        for (int t = 0; t < threads; t++) {
+            DictIdx n = p.counts[(size_t)t * p.regions + r];
+            p.counts[(size_t)t * p.regions + r] = pos;
+            pos += n;
+        }
+    }
+    p.region_start[p.regions] = pos;
+    p.order = allocator_alloc(NULL, (size_t)pos * sizeof(DictIdx) + 1);
+    p.phase = DICT_PLACE_SCATTER;
+    dict__run(threads, dict__place_task, &p);
+    p.phase = DICT_PLACE_FILL;
+    dict__run(threads, dict__place_task, &p);
+    DictIdx dups = 0;
+    for (int t = 0; t < threads; t++) dups += p.dups[t];
+    for (DictIdx r = 0; r < p.regions; r++) { // the serial pass, in the same order
+        for (DictIdx j = 0; j < p.deferred[r]; j++) {
+            DictIdx i = p.order[p.region_start[r] + j];
+            if (!check_dups) {
+                dict__place_new(d, src[i]);
+                continue;
+            }
+            DictKey *k = &d->keys[src[i].data_index];
+            DictIdx idx = dict__find_insert_slot(d, src[i].hash, d->key_arena + k->offset, k->len);
+            if (idx == KEY_ALREADY_EXISTS) {
+                src[i].data_index = DELETED;
+                dups++;
+            } else {
+                dict__set_entry(d, idx, src[i]);
+            }
+        }
+    }
+    allocator_free(NULL, p.order, (size_t)pos * sizeof(DictIdx) + 1);
+    allocator_free(NULL, p.counts, counts_size);
+    allocator_free(NULL, p.region_start, (p.regions + 1) * sizeof(DictIdx));
+    allocator_free(NULL, p.deferred, p.regions * sizeof(DictIdx));
+    allocator_free(NULL, p.dups, threads * sizeof(DictIdx));
+    return dups;
+}
+typedef struct DictBuild {
+    void *dict;
+    const char *keys;
+    size_t key_size;
+    const char *vals;
+    size_t elem_size;
+    DictIdx n;
+    int threads;
+    DictEntry *src;
+} DictBuild;
+// copies and hashes chunk t of the keys, and copies its values
+static void dict__build_task(void *ctx, int t){
+    DictBuild *b = ctx;
+    DictHdr *d = dict__hdr(b->dict);
+    DictIdx lo, hi;
+    dict__chunk(b->n, b->threads, t, &lo, &hi);
+    if (lo == hi) return;
+    memcpy(d->key_arena + (size_t)lo * b->key_size, b->keys + (size_t)lo * b->key_size, (size_t)(hi - lo) * b->key_size);
+    if (b->vals) memcpy((char *)b->dict + (size_t)lo * b->elem_size, b->vals + (size_t)lo * b->elem_size, (size_t)(hi - lo) * b->elem_size);
+    for (DictIdx i = lo; i < hi; i++) {
+        d->keys[i] = (DictKey){i * (DictIdx)b->key_size, (DictIdx)b->key_size, (DictIdx)b->key_size};
+        b->src[i] = (DictEntry){i, dict__key_hash(b->dict, b->keys + (size_t)i * b->key_size, b->key_size)};
+    }
+    if (d->live) {
+        for (DictIdx w = lo >> 6; w < (hi + 63) >> 6; w++) d->live[w] = hi - w * 64 >= 64 ? ~0ull : (1ull << (hi - w * 64)) - 1;
+    }
+}
+// The data slots of duplicate keys (marked DELETED in src) become free slots, or in a dense dict 
+// are filled with the values from the end.
+static void dict__build_holes(void *dict, DictEntry *src, DictIdx n, DictIdx dups){
+    DictHdr *d = dict__hdr(dict);
+    d->len = n - dups;
+    if (!d->dense) {
+        for (DictIdx i = n - 1; i >= 0; i--) { // the lowest index ends up on top of the free list
+            if (src[i].data_index != DELETED) continue;
+            darr_push(d->free_list, i);
+            d->live[i >> 6] &= ~(1ull << (i & 63));
+        }
+        return;
+    }
+    DictIdx last = n - 1;
+    for (DictIdx hole = 0; hole < d->len; hole++) {
+        if (src[hole].data_index != DELETED) continue;
+        while (src[last].data_index == DELETED) last--;
+        dict__move_value(dict, last, hole);
+        last--;
+    }
+}
+// Function: dict__build
+// Description: dict_build_from_arrays. Sizes the table for 'n' keys up front, copies and hashes the 
+//              keys and values in parallel chunks, then fills the table with dict__place_all.
+// Returns:
+//   void * - the dict, which may have moved.
+void *dict__build(void *dict, const void *keys, size_t key_size, const void *vals, size_t elem_size, DictIdx n, int threads){
+    if (n <= 0) return dict;
+    if (dict_count(dict)) return dict__insert_many(dict, keys, key_size, vals, elem_size, n, NULL);
+    if (dict__bytes(n, key_size) > (size_t)DICT_IDX_MAX) dict__too_large("key arena"); // key offsets are DictIdx
+    if (dict) dict_clear(dict); // drops the free list and key bytes of deleted keys
+    else dict = dict__new(&(DictInit){0}, false, 0);
+    DictHdr *d = dict__hdr(dict);
+    DictIdx cap = INITIAL_CAPACITY;
+    while (dict__grow_at(cap, d->max_load) <= n) {
+        if (cap >= DICT_MAX_CAP) dict__too_large("table");
+        cap *= 2;
+    }
+    if (cap > d->cap || d->small) dict = dict__grow(dict, cap, elem_size);
+    d = dict__hdr(dict);
+    darr_fit(d->key_arena, (size_t)n * key_size);
+    darr__hdr(d->key_arena)->len = (ptrdiff_t)((size_t)n * key_size);
+    threads = dict__thread_count(threads);
+    DictBuild b = {dict, keys, key_size, vals, elem_size, n, threads, allocator_alloc(NULL, (size_t)n * sizeof(DictEntry))};
+    dict__run(threads, dict__build_task, &b);
+    DictIdx dups = dict__place_all(d, b.src, n, true, threads);
+    d->len = n;
+    d->key_bytes = (n - dups) * (DictIdx)key_size;
+    if (dups) dict__build_holes(dict, b.src, n, dups);
+    allocator_free(NULL, b.src, (size_t)n * sizeof(DictEntry));
+    return dict;
+}
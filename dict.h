@@ -1,18 +1,134 @@
 #ifndef DICT_H
 #define DICT_H
 #include <stdbool.h> 
+#include <stddef.h> 
+#include <string.h> 
+#include "lib/allocator.h"
+
+// Compile with DICT_LARGE defined (in every translation unit) for dicts of more than 2^31 keys, or 
+// more than 2 GB of keys or values. Data indices, capacities and counts become 64-bit DictIdx, and 
+// hashes 64-bit DictHash, so the table doesn't run out of distinct hashes either. Entries grow from 
+// 8 to 16 bytes. The macros and functions that return an index return a DictIdx.
+#if defined(DICT_LARGE)
+typedef long long DictIdx;
+typedef unsigned long long DictHash;
+#define DICT_HASH_BITS 64
+#define DICT_FIBONACCI 11400714819323198485ull // 2^DICT_HASH_BITS / phi, for the home slot
+#define DICT_IDX_MAX ((DictIdx)0x7fffffffffffffffll)
+#define DICT_MAX_CAP ((DictIdx)1 << 62)
+#else
+typedef int DictIdx;
+typedef unsigned int DictHash;
+#define DICT_HASH_BITS 32
+#define DICT_FIBONACCI 2654435769u
+#define DICT_IDX_MAX ((DictIdx)0x7fffffff)
+#define DICT_MAX_CAP ((DictIdx)1 << 30)
+#endif
 
 typedef struct DictEntry { 
-    int data_index;
-    int hash; 
+    DictIdx data_index;
+    DictHash hash; 
 } DictEntry;
 
+// where the key of a data slot lives in the key arena. Keys are compared only after the hash matches.
+typedef struct DictKey {
+    DictIdx offset; // byte offset into key_arena
+    DictIdx len;    // key size in bytes
+    DictIdx cap;    // bytes reserved at offset. A shorter key reusing the slot keeps them for the next one
+} DictKey;
+
+// A user supplied hash function, see dict_init. 'seed' is the dict's seed.
+typedef DictHash (*DictHashFn)(const void *key, size_t key_size, unsigned long long seed);
+
+// Options for dict_init. Zeroed fields keep the defaults.
+typedef struct DictInit {
+    DictHashFn hash_fn; // NULL: built in. A mixer for 4, 8 and 16 byte keys, wyhash for other sizes.
+    unsigned long long seed; // 0: DICT_DEFAULT_SEED
+    bool random_seed; // pick a per-dict seed at init, so key sets that collide can't be precomputed
+    DictIdx initial_capacity; // keys that fit before the first grow. 0: INITIAL_CAPACITY slots
+    float max_load_factor; // grow once live + deleted entries pass cap * this, in (0, 1). 0: the engine's default
+    int alignment; // of data[], a power of two up to 128. At least 16
+    const Allocator *allocator; // NULL: malloc. Used for every allocation of the dict; must outlive it
+    bool dense; // index-unstable: deleting moves the last value into the hole, so data[0..dict_count) has no holes
+    float shrink_load_factor; // 0: never shrink. Below cap * this live keys, the next insert shrinks the table
+    int threads; // rehashes of DICT_PARALLEL_REHASH_MIN or more keys are split over this many threads. Needs DICT_THREADS
+} DictInit;
+
+#define DICT_DEFAULT_SEED 5381
+
+// Compile with DICT_PROBE_COUNTERS defined (in every translation unit) to count, per dict, the slots 
+// (groups for DICT_SWISS) that lookups and rehash placements probe. Without it they aren't counted 
+// and cost nothing. The counts are plain integers, not atomics.
+typedef struct DictProbeCounters {
+    unsigned long long lookups; // dict__get_entry_index calls (dict_get, dict_get_ptr, dict_delete), and 
+                                // dict_insert's check of the old array during an incremental grow
+    unsigned long long lookup_probes;
+    unsigned long long placements; // entries placed while rehashing (DICT_ROBIN_HOOD: every placement)
+    unsigned long long placement_probes;
+} DictProbeCounters;
+
+#define DICT_PROBE_HIST 16 // buckets of the probe length histograms; the last also counts longer probes
+
+// Filled in by dict_stats.
+typedef struct DictStats {
+    DictIdx cap;
+    DictIdx len; // live keys
+    DictIdx tombstones; // DELETED entries
+    DictIdx free_list_len; // deleted data slots waiting to be reused
+    float load_factor; // (len + tombstones) / cap, what the grow check compares with max_load_factor
+    float max_load_factor;
+    int rehashes; // grows and same-size rehashes since the dict was created
+    // Probe lengths count the slots (groups for DICT_SWISS) a lookup examines; 1 is the home slot. 
+    // Index i counts length i + 1.
+    DictIdx hit_probes[DICT_PROBE_HIST]; // live keys, by the length of a lookup that finds them
+    DictIdx miss_probes[DICT_PROBE_HIST]; // home slots (groups), by the length of a lookup that misses from there
+    size_t entries_bytes; // entries[], plus ctrl[] and the arrays of an incremental grow
+    size_t data_bytes; // the block holding the header and data[]
+    size_t keys_bytes; // key records and the occupancy bitmap
+    size_t key_arena_bytes;
+    size_t free_list_bytes;
+#if defined(DICT_PROBE_COUNTERS)
+    DictProbeCounters probes;
+#endif
+} DictStats;
+
 typedef struct DictHdr {
-    int len; 
-    int cap;
-    int temp_idx; // stores an index used by macros
-    int *free_list; // arr of indices to *entries that have been deleted. 
+    DictIdx len; 
+    DictIdx cap; // always a power of two
+    int shift; // DICT_HASH_BITS - log2(cap). The home slot is the top log2(cap) bits of hash * 2^DICT_HASH_BITS/phi
+    DictIdx temp_idx; // stores an index used by macros
+    DictIdx tombstones; // DELETED entries; they count against the load factor until the next rehash
+    DictIdx *free_list; // arr of indices to *entries that have been deleted. 
     DictEntry *entries; // the actual hashtable - contains an index to data[] where the values are stored and a hash
+    signed char *ctrl; // DICT_SWISS only: one control byte per entry, 7 bits of hash or EMPTY/DELETED
+    DictEntry *old_entries; // DICT_INCREMENTAL_GROW only: the previous entry array while it is migrated
+    DictIdx old_cap;
+    int old_shift;
+    DictIdx migrate_pos; // next slot of old_entries to move
+    DictEntry *next_entries; // DICT_INCREMENTAL_GROW only: the next entry array, filled with EMPTY ahead of the grow
+    DictIdx next_cap;
+    DictIdx next_init; // slots of next_entries filled so far
+    DictKey *keys; // one per data slot, parallel to data[]
+    unsigned long long *live; // bit i set while data[i] holds a value. Not kept for dense dicts
+    char *key_arena; // darr of raw key bytes. Fixed-size keys end up packed back to back.
+    DictIdx key_bytes; // bytes of the live keys in key_arena. The rest is garbage, see dict__store_key
+    DictHashFn hash_fn; // NULL unless set by dict_init
+    unsigned long long seed;
+    DictIdx grow_at; // grow when live + DELETED entries reach this: cap * max_load
+    float max_load;
+    DictIdx shrink_at; // an insert with fewer live entries than this shrinks the table: cap * shrink_load. 0: never
+    float shrink_load;
+    int rehashes; // times the entry array was rebuilt, by a grow or a same-size rehash
+    int threads; // see DictInit
+#if defined(DICT_PROBE_COUNTERS)
+    DictProbeCounters probes;
+#endif
+    int alignment; // of data[]
+    size_t alloc_size; // bytes in the block holding the header and data[]
+    const Allocator *allocator; // NULL: malloc
+    size_t elem_size; // of data[]
+    bool dense; // see DictInit
+    bool small; // entries[] and the other arrays share this block and are scanned linearly, see DICT_SMALL_CAP
     char padding; // some padding for alignment
     char data[];  // aligned data array - where the raw data is stored
 } DictHdr;
@@ -20,18 +136,31 @@ typedef struct DictHdr {
 ///////////////////////
 // These functions are internal but are utilized by macros so need to be declared here.
 ///////////////////////
-DictHdr *dict__hdr(void *d);
-int dict__get(void *dict, void *key, size_t key_size);
-int dict__delete(void *dict, void *key, size_t key_size);
-bool dict__insert_entry(void *dict, void *key, size_t key_size);
-bool dict__find_entry(void *dict, void *key, size_t key_size);
-void *dict__grow(void *dict, int new_cap, size_t elem_size) ;
+static inline DictHdr *dict__hdr(void *d);
+DictIdx dict__get(void *dict, void *key, size_t key_size, DictHash hash);
+DictIdx dict__delete(void *dict, void *key, size_t key_size, DictHash hash);
+bool dict__insert_entry(void *dict, void *key, size_t key_size, DictHash hash);
+bool dict__find_entry(void *dict, void *key, size_t key_size, DictHash hash);
+void *dict__init(void *dict, const DictInit *init, size_t elem_size);
+DictHash dict__hash_bytes(const void *key, size_t key_size, unsigned long long seed);
+void dict__get_many(void *dict, const void *keys, size_t key_size, DictIdx n, DictIdx *out);
+void dict__delete_many(void *dict, const void *keys, size_t key_size, DictIdx n, DictIdx *out);
+void *dict__insert_many(void *dict, const void *keys, size_t key_size, const void *vals, size_t elem_size, DictIdx n, DictIdx *out);
+void *dict__build(void *dict, const void *keys, size_t key_size, const void *vals, size_t elem_size, DictIdx n, int threads);
+void *dict__grow(void *dict, DictIdx new_cap, size_t elem_size) ;
+DictIdx dict__grow_cap(void *dict, DictIdx n);
+void *dict__refit(void *dict, DictIdx n, size_t elem_size);
+void *dict__shrink_to_fit(void *dict, size_t elem_size);
 void dict__free(void *dict);
+unsigned int dict__engine_id(void);
 ///////////////////////
 ///////////////////////
 // Declarations:
-static inline int dict_count(void *d);
-static inline int dict_cap(void *d);
+static inline DictIdx dict_count(void *d);
+static inline DictIdx dict_cap(void *d);
+static inline bool dict__has_room(void *d, DictIdx n);
+static inline void dict__set_flag(bool *flag, bool value);
+static inline DictHash dict__key_hash(void *d, const void *key, size_t key_size);
 
 // Helper Macros - Utilized by other macros.
 // =========================================
@@ -42,20 +171,60 @@ static inline int dict_cap(void *d);
 // dict__idx_to_val: Retrieves the value corresponding to the index 'idx' in dictionary 'd'. 
 // Note: caller should ensure 'd' is valid
 #define dict__idx_to_val(d,idx) ( (d)[ dict__entries(d)[(idx)].data_index ] )  
-// if the number of entries is more than half the size of the capacity, double the capacity.
+// Compile with DICT_SWISS defined (in every translation unit) to use the group-probing engine, 
+// which runs at a 7/8 load factor. The default linear probing engine runs at 1/2, as does 
+// DICT_ROBIN_HOOD, which reorders linear probing and deletes without tombstones.
+#if defined(DICT_SWISS)
+#define DICT_MAX_LOAD_NUM 7
+#define DICT_MAX_LOAD_DEN 8
+#else
+#define DICT_MAX_LOAD_NUM 1
+#define DICT_MAX_LOAD_DEN 2
+#endif
+// DICT_INCREMENTAL_GROW (default engine only): growing allocates the new entry array and every later 
+// insert/get/delete moves DICT_MIGRATE_STEP slots of the old one over, so no single call rehashes 
+// the whole table. Lookups check both arrays until the move is done.
+#ifndef DICT_MIGRATE_STEP
+#define DICT_MIGRATE_STEP 16
+#endif
+// if live plus DELETED entries pass the load factor (dict_init can change it), grow (or rehash in 
+// place, see dict__grow_cap). With a shrink_load_factor set, also shrink once live entries drop below it.
+// INITIAL_CAPACITY must be a power of two; doubling keeps it one.
 #define INITIAL_CAPACITY 64
-#define dict__fit(d, n) ((n) * 2 < dict_cap(d) ? 0 : ((d) = dict__grow((d), ((d) ? 2 * dict_cap(d) : INITIAL_CAPACITY), sizeof(*(d)))))
+// A dict starts small: up to DICT_SMALL_CAP keys, with the entries, key records, occupancy bitmap, 
+// free list and DICT_SMALL_KEY_BYTES of key bytes in the same allocation as the header and data. 
+// Lookups scan the stored hashes in order instead of probing. The insert that passes DICT_SMALL_CAP 
+// moves the dict to the hashed layout at INITIAL_CAPACITY. A power of two up to 32; 0 disables it.
+#ifndef DICT_SMALL_CAP
+#define DICT_SMALL_CAP 16
+#endif
+#ifndef DICT_SMALL_KEY_BYTES
+#define DICT_SMALL_KEY_BYTES (DICT_SMALL_CAP * 16) // longer keys move the key bytes to their own allocation
+#endif
+#define dict__live_words(cap) (((cap) + 63) / 64) // occupancy bitmap words for 'cap' data slots
+#define dict__fit(d, n) (dict__has_room((d), (n)) ? 0 : ((d) = dict__refit((d), (n), sizeof(*(d)))))
+// dict__hash_of: hashes the key 'k' points to. sizeof(*(k)) is a constant, so the 4, 8 and 16 byte 
+// mixers in dict__key_hash are picked at compile time.
+#define dict__hash_of(d, k) dict__key_hash((d), (k), sizeof(*(k)))
 ////////////////////////////////////////////
 ////////////////////////////////////////////
 
+// optional init: allocates the dict with the options in DictInit. d must be NULL.
+// Fields are given as designated initializers:
+//     dict_init(d, .random_seed = true);
+//     dict_init(d, .hash_fn = my_hash, .seed = 42);
+//     dict_init(d, .initial_capacity = 1000000); // bulk load without rehashing
+//     dict_init(d, .max_load_factor = 0.75f, .alignment = 64, .allocator = &my_allocator);
+#define dict_init(d, ...) ((d) = dict__init((d), &(DictInit){__VA_ARGS__}, sizeof(*(d))))
+
 // returns the index in the data array where the value is stored. If key exists returns -1. 
 // param - d: pointer to array of v's
 //         k: ptr to key of any type
 //         v: value of any chosen type
-#define dict_insert(d, k, v) (dict__fit((d), dict_count(d)), (dict__insert_entry((d), (k), sizeof(*(k))) ? ((d)[dict__hdr(d)->temp_idx] = (v)), dict__hdr(d)->temp_idx : -1)) 
+#define dict_insert(d, k, v) (dict__fit((d), dict_count(d)), (dict__insert_entry((d), (k), sizeof(*(k)), dict__hash_of((d), (k))) ? ((d)[dict__hdr(d)->temp_idx] = (v)), dict__hdr(d)->temp_idx : -1)) 
 // same as above but uses a string as key value
 // todo: test
-#define dict_keystr_insert(d, k, v, key_size) (dict__fit((d), dict_count(d)), (dict__insert_entry((d), (k), (key_size)) ? ((d)[dict__hdr(d)->temp_idx] = (v)), dict__hdr(d)->temp_idx : -1)) 
+#define dict_keystr_insert(d, k, v, key_size) (dict__fit((d), dict_count(d)), (dict__insert_entry((d), (k), (key_size), dict__key_hash((d), (k), (key_size))) ? ((d)[dict__hdr(d)->temp_idx] = (v)), dict__hdr(d)->temp_idx : -1)) 
 
 // dict_get_ptr: Retrieves a pointer to the value associated with the key 'k' in dictionary 'd'.
 // Parameters:
@@ -64,7 +233,7 @@ static inline int dict_cap(void *d);
 // Returns: A pointer to the value corresponding to 'k' in 'd', or NULL if the key is not found.
 // Note: This macro leverages dict__find_entry for key lookup. If the key is found, it returns the address 
 // of the value using dict__idx_to_val; otherwise, it returns NULL.
-#define dict_get_ptr(d,k) (dict__find_entry((d), (k), sizeof(*(k))) ? &dict__idx_to_val((d), dict__temp_idx(d)) : NULL)  
+#define dict_get_ptr(d,k) (dict__find_entry((d), (k), sizeof(*(k)), dict__hash_of((d), (k))) ? &dict__idx_to_val((d), dict__temp_idx(d)) : NULL)  
 // dict_keystr_get: Retrieves a pointer to the value associated with a C-string key 'k' in dictionary 'd'.
 // Parameters:
 // - 'd' is the dictionary from which to retrieve the value.
@@ -73,28 +242,142 @@ static inline int dict_cap(void *d);
 // Returns: A pointer to the value corresponding to 'k' in 'd', or NULL if the key is not found.
 // Note: This macro uses dict__find_entry to search for the key. If the key is found, it returns 
 // the address of the value using dict__idx_to_val; otherwise, it returns NULL.
-#define dict_keystr_get_ptr(d,k, key_size) (dict__find_entry((d), (k), (key_size)) ? &dict__idx_to_val((d), dict__temp_idx(d)) : NULL)  
+#define dict_keystr_get_ptr(d,k, key_size) (dict__find_entry((d), (k), (key_size), dict__key_hash((d), (k), (key_size))) ? &dict__idx_to_val((d), dict__temp_idx(d)) : NULL)  
 
-// Useful? untested
-#define dict_get_or_set_default(d,k,v) ( dict__find_entry((d), (k), sizeof(*(k))) ?               \
-                               ( &dict__idx_to_val((d), dict__temp_idx(d))) :                     \
-                               ( (dict_insert((d), (k), (v))), dict_get_ptr((d), (k))) )
+// dict_upsert: returns the data index of key 'k', adding the key first if it is missing, in one probe. 
+// '*inserted' (pass NULL to skip) is set to whether the key is new; a new slot holds whatever was 
+// there before, so the caller initializes it:
+//     bool added;
+//     DictIdx i = dict_upsert(counts, &word, &added);
+//     if (added) counts[i] = 0;
+//     counts[i]++;
+#define dict_upsert(d, k, inserted) (dict__fit((d), dict_count(d)), \
+    dict__set_flag((inserted), dict__insert_entry((d), (k), sizeof(*(k)), dict__hash_of((d), (k)))), dict__hdr(d)->temp_idx)
+#define dict_keystr_upsert(d, k, key_size, inserted) (dict__fit((d), dict_count(d)), \
+    dict__set_flag((inserted), dict__insert_entry((d), (k), (key_size), dict__key_hash((d), (k), (key_size)))), dict__hdr(d)->temp_idx)
+
+// dict_get_or_set_default: a pointer to the value of 'k', which is set to 'v' first if 'k' is new. 
+// One probe, like dict_upsert:
+//     (*dict_get_or_set_default(counts, &word, 0))++;
+// The pointer is invalidated by the next insert, which may move the dict.
+#define dict_get_or_set_default(d, k, v) (dict__fit((d), dict_count(d)), \
+    (dict__insert_entry((d), (k), sizeof(*(k)), dict__hash_of((d), (k))) ? (void)((d)[dict__hdr(d)->temp_idx] = (v)) : (void)0), \
+    &(d)[dict__hdr(d)->temp_idx])
+#define dict_keystr_get_or_set_default(d, k, key_size, v) (dict__fit((d), dict_count(d)), \
+    (dict__insert_entry((d), (k), (key_size), dict__key_hash((d), (k), (key_size))) ? (void)((d)[dict__hdr(d)->temp_idx] = (v)) : (void)0), \
+    &(d)[dict__hdr(d)->temp_idx])
 
 // returns the data index of deleted item or EMPTY (-1 for ints). The user should mark this 
 // data as invalid in some way if the user intends to iterate over the data array.
+// In a dense dict (dict_init(d, .dense = true)) the last value has already been moved into the 
+// returned index, unless the deleted value was the last one; nothing needs to be marked, and 
+// data[0..dict_count(d)) holds exactly the live values. Indices of moved values change.
+
+#define dict_delete(d,k) (dict__delete(d, k, sizeof(*(k)), dict__hash_of((d), (k)))) // returns index to deleted data
 
-#define dict_delete(d,k) (dict__delete(d, k, sizeof(*(k)))) // returns index to deleted data
+#define dict_get(d,k) (dict__get(d, k, sizeof(*(k)), dict__hash_of((d), (k)))) // returns index to data
 
-#define dict_get(d,k) (dict__get(d, k, sizeof(*(k)))) // returns index to data
+// Batched dict_get / dict_insert / dict_delete over an array of 'n' keys (any fixed-size type). 
+// Hashing the batch first and prefetching ahead overlaps the cache misses of different keys, 
+// which pays off once the table is bigger than the cache.
+// 'out' is a DictIdx array of n, receiving a data index per key or -1: not found for get and delete, 
+// already present for insert. It may be NULL for insert and delete.
+// dict_insert_many copies vals[i] (same type as the dict, or NULL to skip) into each new slot.
+#define dict_get_many(d, keys, n, out) dict__get_many((d), (keys), sizeof(*(keys)), (n), (out))
+#define dict_insert_many(d, keys, vals, n, out) ((d) = dict__insert_many((d), (keys), sizeof(*(keys)), (vals), sizeof(*(d)), (n), (out)))
+#define dict_delete_many(d, keys, n, out) dict__delete_many((d), (keys), sizeof(*(keys)), (n), (out))
+
+// dict_build_from_arrays: fills an empty dict (NULL, or made by dict_init for its options) with 'n' 
+// keys and values (vals may be NULL) at once. keys[i] gets data index i; when a key repeats, the 
+// first copy is kept and the slots of the others are free (filled from the end in a dense dict). 
+// The keys are hashed and copied, and the table is filled, by 'threads' threads when compiled with 
+// DICT_THREADS defined, and by one otherwise. A dict that already holds keys gets dict_insert_many.
+//     dict_build_from_arrays(users, ids, records, n, 16);
+#define dict_build_from_arrays(d, keys, vals, n, threads) ((d) = dict__build((d), (keys), sizeof(*(keys)), (vals), sizeof(*(d)), (n), (threads)))
+// Defining DICT_THREADS (in dict.c's translation unit; link with -pthread) lets dict_build_from_arrays 
+// and the rehashes of dicts made with dict_init(d, .threads = n) run on several threads. A rehash 
+// goes parallel from DICT_PARALLEL_REHASH_MIN live keys; below that, starting threads costs more.
+#ifndef DICT_PARALLEL_REHASH_MIN
+#define DICT_PARALLEL_REHASH_MIN (1 << 20)
+#endif
 
 #define dict_free(d) ((d) ? (dict__free(d), (d) = NULL, 1) : 0)
 
-static inline int dict_count(void *d){ return d ? dict__hdr(d)->len : 0; } // how many valid entries in the dicctionary; not for iterating directly over the data 
-static inline int dict_cap(void *d){ return d ? dict__hdr(d)->cap : 0; }
+// dict_shrink_to_fit: reallocates the table, data array and key records to the smallest capacity 
+// that holds the live values, and drops DELETED entries. The key arena is rebuilt from the live 
+// keys and an oversized free list is copied, even when the table is already that size. Indices 
+// don't change, so deleted slots below the highest live index are kept; call dict_compact first to 
+// get rid of those too.
+// dict_init(d, .shrink_load_factor = 0.1f) does this on the first insert after the live count 
+// falls below a tenth of the capacity, leaving room to grow back.
+#define dict_shrink_to_fit(d) ((d) = dict__shrink_to_fit((d), sizeof(*(d))))
+
+// dict_foreach: loops 'i' over the data index of every value, skipping deleted slots, in index order:
+//     dict_foreach(d, i) printf("%d\n", d[i]);
+// Deleting d[i] inside the loop is fine; values inserted during the loop may or may not be visited.
+// In a dense dict, deleting d[i] moves the last value into slot i, so the loop looks at slot i again. 
+// Deleting any other value there can skip or repeat one.
+#define dict_foreach(d, i) \
+    for (DictIdx i = dict_next_live((d), 0), dict__count_##i = dict_count(d); i != -1; i = dict__foreach_next((d), (i), &dict__count_##i))
+
+static inline DictHdr *dict__hdr(void *d){
+    return (DictHdr *)( (char *)d - offsetof(DictHdr, data) - *((char*)d - 1) );
+}
+static inline unsigned long long dict__mix64(unsigned long long x){ // murmur3 finalizer
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+// The built in hash. Integer keys, the bulk of most tables, skip the byte loop entirely.
+static inline DictHash dict__hash_seeded(const void *key, size_t key_size, unsigned long long seed){
+    if(key_size == 4){
+        unsigned int k;
+        memcpy(&k, key, 4);
+        return (DictHash)dict__mix64(k ^ seed);
+    }
+    if(key_size == 8){
+        unsigned long long k;
+        memcpy(&k, key, 8);
+        return (DictHash)dict__mix64(k ^ seed);
+    }
+    if(key_size == 16){
+        unsigned long long k[2];
+        memcpy(k, key, 16);
+        return (DictHash)dict__mix64(dict__mix64(k[0] ^ seed) ^ k[1]);
+    }
+    return dict__hash_bytes(key, key_size, seed);
+}
+// Picks the hash for a key: the dict's hash_fn if it has one, the built in one otherwise.
+static inline DictHash dict__key_hash(void *d, const void *key, size_t key_size){
+    if(!d) return 0; // nothing to find in an empty dict
+    DictHdr *h = dict__hdr(d);
+    if(h->hash_fn) return h->hash_fn(key, key_size, h->seed);
+    return dict__hash_seeded(key, key_size, h->seed);
+}
+static inline void dict__set_flag(bool *flag, bool value){ if(flag) *flag = value; }
+static inline bool dict__has_room(void *d, DictIdx n){ 
+    return d && (long long)n + dict__hdr(d)->tombstones < dict__hdr(d)->grow_at && n >= dict__hdr(d)->shrink_at; 
+}
+static inline DictIdx dict_count(void *d){ return d ? dict__hdr(d)->len : 0; } // how many valid entries in the dicctionary; not for iterating directly over the data 
+static inline DictIdx dict_cap(void *d){ return d ? dict__hdr(d)->cap : 0; }
 
-int dict_keystr_get(void *dict, void *key, size_t key_size); // same as dict_get but for keys that are strings
-int dict_keystr_delete(void *dict, void *key, size_t key_size); // returns index to deleted data
-int dict_range(void *dict); // for iterating over the data array
-void dict_clear(void *dict);
+DictIdx dict_keystr_get(void *dict, void *key, size_t key_size); // same as dict_get but for keys that are strings
+DictIdx dict_keystr_delete(void *dict, void *key, size_t key_size); // returns index to deleted data
+DictIdx dict_range(void *dict); // for iterating over the data array
+DictIdx dict_next_live(void *dict, DictIdx i); // first data index >= i holding a value, or -1. See dict_foreach
+DictIdx dict__foreach_next(void *dict, DictIdx i, DictIdx *count);
+DictHash dict_hash_murmur2(const void *key, size_t key_size, unsigned long long seed); // the original 32-bit hash, usable as a DictHashFn
+void dict_clear(void *dict); // keeps the memory; follow with dict_shrink_to_fit to release it
+// Moves the values at the end of the data array into the holes in the free list, so data[0..dict_count) 
+// holds every value. 'remap' is NULL or an array of dict_range(d) DictIdx, taken before the call, and 
+// receives the new index of every old one (-1 for deleted slots). Returns how many values moved.
+DictIdx dict_compact(void *dict, DictIdx *remap);
+// Fills 'out' with the size, occupancy, probe length histograms and memory use of the dict. Walks 
+// the whole table, so it is for diagnostics, not hot paths. Keys still in the old array of an 
+// incremental grow are not in the histograms.
+void dict_stats(void *dict, DictStats *out);
 
 #endif /* DICT_H */
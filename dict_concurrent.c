@@ -0,0 +1,328 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "lib/darr.h"
+#include "dict.h"
+#include "dict_concurrent.h"
+
+#define stmnt(s) do { s } while (0)
+#define assert_break() (*(int*)0 = 0)
+#define assert(x) stmnt(if (!(x)) { assert_break(); })
+
+#if defined(_WIN32)
+#include <windows.h>
+typedef SRWLOCK CDictLock;
+#define cdict__lock_init(l) InitializeSRWLock(l)
+#define cdict__lock(l) AcquireSRWLockExclusive(l)
+#define cdict__unlock(l) ReleaseSRWLockExclusive(l)
+#define cdict__lock_destroy(l) ((void)(l))
+#else
+#include <pthread.h>
+typedef pthread_mutex_t CDictLock;
+#define cdict__lock_init(l) pthread_mutex_init((l), NULL)
+#define cdict__lock(l) pthread_mutex_lock(l)
+#define cdict__unlock(l) pthread_mutex_unlock(l)
+#define cdict__lock_destroy(l) pthread_mutex_destroy(l)
+#endif
+
+#define CDICT_DEFAULT_SHARDS 64
+#define CDICT_SHARD_INITIAL_CAPACITY 16
+#define CDICT_RECLAIM_BATCH 64 // retired pointers per shard before trying to free some
+#define CDICT_CACHE_LINE 64
+
+// A key/value pair. Never modified once it is published in a slot, so readers can copy the value
+// without locks; an update publishes a new node and retires the old one.
+typedef struct CDictNode {
+    DictHash hash; // all DICT_HASH_BITS of it: 64 under DICT_LARGE
+    int key_len;
+    char bytes[]; // the key, then the value
+} CDictNode;
+
+// Deleted slots point here. Slots never go back to NULL, so a reader's probe sequence stays intact.
+static char cdict__tombstone_byte;
+#define CDICT_TOMBSTONE ((CDictNode *)&cdict__tombstone_byte)
+
+// Linear probing over node pointers. Replaced as a whole when the shard grows.
+typedef struct CDictTable {
+    int cap; // power of two
+    int shift; // DICT_HASH_BITS - log2(cap), for the fibonacci home slot as in dict.c
+    _Atomic(CDictNode *) slots[];
+} CDictTable;
+
+typedef struct CDictRetired {
+    void *ptr;
+    unsigned long long epoch; // global epoch when it was unlinked
+} CDictRetired;
+
+typedef struct CDictShard {
+    _Atomic(CDictTable *) table;
+    CDictLock lock; // held by writers only
+    _Atomic int len;
+    int tombstones;
+    CDictRetired *retired; // darr, guarded by lock
+    char pad[CDICT_CACHE_LINE]; // keeps neighbouring shards' locks off each other's cache lines
+} CDictShard;
+
+// 0 while the thread is outside the dict, otherwise the epoch it entered in
+typedef struct CDictReader {
+    _Atomic unsigned long long epoch;
+    char pad[CDICT_CACHE_LINE - sizeof(unsigned long long)];
+} CDictReader;
+
+struct ConcurrentDict {
+    CDictReader readers[CDICT_MAX_THREADS]; // first, so the cache line alignment of the allocation applies
+    _Atomic unsigned long long epoch; // starts at 1
+    size_t elem_size;
+    int shard_mask;
+    unsigned long long seed;
+    CDictShard *shards;
+    void *alloc_base; // what malloc returned, before aligning
+};
+
+// Reader slots are shared by every ConcurrentDict; a thread claims one on first use.
+static _Atomic int cdict__slot_used[CDICT_MAX_THREADS];
+static _Thread_local int cdict__slot = -1;
+
+static int cdict__thread_slot(void){
+    if (cdict__slot >= 0) return cdict__slot;
+    for (int i = 0; i < CDICT_MAX_THREADS; i++) {
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&cdict__slot_used[i], &expected, 1)) {
+            cdict__slot = i;
+            return i;
+        }
+    }
+    assert(0 && "cdict: more than CDICT_MAX_THREADS threads, see cdict_thread_release");
+    return -1;
+}
+void cdict_thread_release(void){
+    if (cdict__slot < 0) return;
+    atomic_store(&cdict__slot_used[cdict__slot], 0);
+    cdict__slot = -1;
+}
+
+static void *cdict__malloc(size_t size){
+    void *p = malloc(size);
+    if (!p) {
+        perror("malloc failed");
+        exit(1);
+    }
+    return p;
+}
+static CDictTable *cdict__table_new(int cap){
+    CDictTable *t = cdict__malloc(offsetof(CDictTable, slots) + cap * sizeof(t->slots[0]));
+    t->cap = cap;
+    t->shift = DICT_HASH_BITS;
+    for (int c = cap; c > 1; c >>= 1) t->shift--;
+    for (int i = 0; i < cap; i++) atomic_init(&t->slots[i], NULL);
+    return t;
+}
+static inline int cdict__home_slot(DictHash hash, int shift){
+    return (int)((hash * DICT_FIBONACCI) >> shift);
+}
+static inline CDictShard *cdict__shard(ConcurrentDict *cd, DictHash hash){
+    return &cd->shards[hash & cd->shard_mask]; // the low bits; the home slot uses the high bits
+}
+
+ConcurrentDict *cdict_new(size_t elem_size, int shard_count){
+    int shards = 1;
+    while (shards < (shard_count > 0 ? shard_count : CDICT_DEFAULT_SHARDS)) shards <<= 1;
+    void *base = cdict__malloc(sizeof(ConcurrentDict) + CDICT_CACHE_LINE);
+    ConcurrentDict *cd = (ConcurrentDict *)(((uintptr_t)base + CDICT_CACHE_LINE - 1) & ~(uintptr_t)(CDICT_CACHE_LINE - 1));
+    cd->alloc_base = base;
+    for (int i = 0; i < CDICT_MAX_THREADS; i++) atomic_init(&cd->readers[i].epoch, 0);
+    atomic_init(&cd->epoch, 1);
+    cd->elem_size = elem_size;
+    cd->shard_mask = shards - 1;
+    cd->seed = DICT_DEFAULT_SEED;
+    cd->shards = cdict__malloc(shards * sizeof(CDictShard));
+    for (int i = 0; i < shards; i++) {
+        CDictShard *s = &cd->shards[i];
+        atomic_init(&s->table, cdict__table_new(CDICT_SHARD_INITIAL_CAPACITY));
+        cdict__lock_init(&s->lock);
+        atomic_init(&s->len, 0);
+        s->tombstones = 0;
+        s->retired = NULL;
+    }
+    return cd;
+}
+void cdict_free(ConcurrentDict *cd){
+    if (!cd) return;
+    for (int i = 0; i <= cd->shard_mask; i++) {
+        CDictShard *s = &cd->shards[i];
+        CDictTable *t = atomic_load(&s->table);
+        for (int j = 0; j < t->cap; j++) {
+            CDictNode *n = atomic_load_explicit(&t->slots[j], memory_order_relaxed);
+            if (n && n != CDICT_TOMBSTONE) free(n);
+        }
+        free(t);
+        for (int j = 0; j < darr_len(s->retired); j++) free(s->retired[j].ptr);
+        darr_free(s->retired);
+        cdict__lock_destroy(&s->lock);
+    }
+    free(cd->shards);
+    free(cd->alloc_base);
+}
+int cdict_count(ConcurrentDict *cd){
+    int count = 0;
+    for (int i = 0; i <= cd->shard_mask; i++) count += atomic_load_explicit(&cd->shards[i].len, memory_order_relaxed);
+    return count;
+}
+
+// Entering stores the current epoch in the thread's slot. The store is seq_cst so it is visible
+// before any table or node pointer is loaded; a writer that unlinks something afterwards sees it.
+static inline CDictReader *cdict__read_begin(ConcurrentDict *cd){
+    CDictReader *r = &cd->readers[cdict__thread_slot()];
+    atomic_store(&r->epoch, atomic_load(&cd->epoch));
+    return r;
+}
+static inline void cdict__read_end(CDictReader *r){
+    atomic_store_explicit(&r->epoch, 0, memory_order_release);
+}
+// Advances the global epoch if every reader inside has caught up with it, then frees what was
+// retired at least two epochs ago: no reader can still hold those pointers.
+static void cdict__reclaim(ConcurrentDict *cd, CDictShard *s){
+    unsigned long long g = atomic_load(&cd->epoch);
+    bool caught_up = true;
+    for (int i = 0; i < CDICT_MAX_THREADS && caught_up; i++) {
+        unsigned long long e = atomic_load(&cd->readers[i].epoch);
+        caught_up = (e == 0 || e == g);
+    }
+    if (caught_up) {
+        atomic_compare_exchange_strong(&cd->epoch, &g, g + 1);
+        g = atomic_load(&cd->epoch);
+    }
+    int kept = 0;
+    for (int i = 0; i < darr_len(s->retired); i++) {
+        if (s->retired[i].epoch + 2 <= g) free(s->retired[i].ptr);
+        else s->retired[kept++] = s->retired[i];
+    }
+    darr__hdr(s->retired)->len = kept;
+}
+// called with the shard locked, after 'ptr' has been unlinked
+static void cdict__retire(ConcurrentDict *cd, CDictShard *s, void *ptr){
+    darr_push(s->retired, (CDictRetired){ptr, atomic_load(&cd->epoch)});
+    if (darr_len(s->retired) >= CDICT_RECLAIM_BATCH) cdict__reclaim(cd, s);
+}
+
+static CDictNode *cdict__find(CDictTable *t, DictHash hash, const void *key, size_t key_size, int *slot){
+    int mask = t->cap - 1;
+    int idx = cdict__home_slot(hash, t->shift);
+    for (int j = 0; j < t->cap; j++) {
+        CDictNode *n = atomic_load_explicit(&t->slots[idx], memory_order_acquire);
+        if (!n) return NULL;
+        if (n != CDICT_TOMBSTONE && n->hash == hash && n->key_len == (int)key_size
+            && memcmp(n->bytes, key, key_size) == 0) {
+            if (slot) *slot = idx;
+            return n;
+        }
+        idx = (idx + 1) & mask;
+    }
+    return NULL;
+}
+// first free slot for a key that is known to be absent
+static int cdict__free_slot(CDictTable *t, DictHash hash){
+    int mask = t->cap - 1;
+    int idx = cdict__home_slot(hash, t->shift);
+    while (true) {
+        CDictNode *n = atomic_load_explicit(&t->slots[idx], memory_order_relaxed);
+        if (!n || n == CDICT_TOMBSTONE) return idx;
+        idx = (idx + 1) & mask;
+    }
+}
+// Copies the live nodes into a new table and publishes it. Readers still in the old table keep
+// reading it until they leave; it is retired, not freed.
+static CDictTable *cdict__grow(ConcurrentDict *cd, CDictShard *s, CDictTable *t){
+    int len = atomic_load_explicit(&s->len, memory_order_relaxed);
+    int new_cap = (len + 1) * 4 < t->cap ? t->cap : 2 * t->cap; // mostly tombstones: same size
+    CDictTable *nt = cdict__table_new(new_cap);
+    for (int i = 0; i < t->cap; i++) {
+        CDictNode *n = atomic_load_explicit(&t->slots[i], memory_order_relaxed);
+        if (!n || n == CDICT_TOMBSTONE) continue;
+        atomic_store_explicit(&nt->slots[cdict__free_slot(nt, n->hash)], n, memory_order_relaxed);
+    }
+    atomic_store(&s->table, nt);
+    s->tombstones = 0;
+    cdict__retire(cd, s, t);
+    return nt;
+}
+static CDictNode *cdict__node_new(ConcurrentDict *cd, DictHash hash, const void *key, size_t key_size, const void *val){
+    CDictNode *n = cdict__malloc(sizeof(CDictNode) + key_size + cd->elem_size);
+    n->hash = hash;
+    n->key_len = (int)key_size;
+    if (key_size) memcpy(n->bytes, key, key_size);
+    memcpy(n->bytes + key_size, val, cd->elem_size);
+    return n;
+}
+
+// Function: cdict__get
+// Description: Lock-free lookup. Copies the value into 'out' (elem_size bytes).
+// Returns:
+//   bool - True if the key was found.
+bool cdict__get(ConcurrentDict *cd, const void *key, size_t key_size, void *out){
+    DictHash hash = dict__hash_seeded(key, key_size, cd->seed);
+    CDictShard *s = cdict__shard(cd, hash);
+    CDictReader *r = cdict__read_begin(cd);
+    CDictTable *t = atomic_load(&s->table);
+    CDictNode *n = cdict__find(t, hash, key, key_size, NULL);
+    if (n) memcpy(out, n->bytes + n->key_len, cd->elem_size);
+    cdict__read_end(r);
+    return n != NULL;
+}
+static bool cdict__write(ConcurrentDict *cd, const void *key, size_t key_size, const void *val, bool replace){
+    DictHash hash = dict__hash_seeded(key, key_size, cd->seed);
+    CDictShard *s = cdict__shard(cd, hash);
+    cdict__lock(&s->lock);
+    CDictTable *t = atomic_load_explicit(&s->table, memory_order_relaxed); // only writers change it, under the lock
+    int slot;
+    CDictNode *old = cdict__find(t, hash, key, key_size, &slot);
+    if (old) {
+        if (replace) {
+            atomic_store_explicit(&t->slots[slot], cdict__node_new(cd, hash, key, key_size, val), memory_order_release);
+            cdict__retire(cd, s, old);
+        }
+        cdict__unlock(&s->lock);
+        return false;
+    }
+    int len = atomic_load_explicit(&s->len, memory_order_relaxed);
+    if ((len + s->tombstones + 1) * 2 > t->cap) t = cdict__grow(cd, s, t);
+    slot = cdict__free_slot(t, hash);
+    if (atomic_load_explicit(&t->slots[slot], memory_order_relaxed) == CDICT_TOMBSTONE) s->tombstones -= 1;
+    // release: a reader that sees the pointer sees the node's contents
+    atomic_store_explicit(&t->slots[slot], cdict__node_new(cd, hash, key, key_size, val), memory_order_release);
+    atomic_store_explicit(&s->len, len + 1, memory_order_relaxed);
+    cdict__unlock(&s->lock);
+    return true;
+}
+// Function: cdict__insert
+// Returns:
+//   bool - True if the key was added, false if it was already present (its value is unchanged).
+bool cdict__insert(ConcurrentDict *cd, const void *key, size_t key_size, const void *val){
+    return cdict__write(cd, key, key_size, val, false);
+}
+void cdict__put(ConcurrentDict *cd, const void *key, size_t key_size, const void *val){
+    cdict__write(cd, key, key_size, val, true);
+}
+// Function: cdict__delete
+// Description: Removes a key, copying its value to 'out' first unless out is NULL.
+// Returns:
+//   bool - True if the key was present.
+bool cdict__delete(ConcurrentDict *cd, const void *key, size_t key_size, void *out){
+    DictHash hash = dict__hash_seeded(key, key_size, cd->seed);
+    CDictShard *s = cdict__shard(cd, hash);
+    cdict__lock(&s->lock);
+    CDictTable *t = atomic_load_explicit(&s->table, memory_order_relaxed);
+    int slot;
+    CDictNode *n = cdict__find(t, hash, key, key_size, &slot);
+    if (n) {
+        if (out) memcpy(out, n->bytes + n->key_len, cd->elem_size);
+        atomic_store_explicit(&t->slots[slot], CDICT_TOMBSTONE, memory_order_release);
+        atomic_store_explicit(&s->len, atomic_load_explicit(&s->len, memory_order_relaxed) - 1, memory_order_relaxed);
+        s->tombstones += 1;
+        cdict__retire(cd, s, n);
+    }
+    cdict__unlock(&s->lock);
+    return n != NULL;
+}
@@ -0,0 +1,48 @@
+#ifndef DICT_CONCURRENT_H
+#define DICT_CONCURRENT_H
+#include <stdbool.h>
+#include <stddef.h>
+
+// A thread-safe dictionary. Unlike the dict_* macros nothing is passed through header state:
+// every call takes the key and returns its result directly, and values are copied in and out.
+//
+// Readers take no locks. They announce the epoch they read in, probe, and copy the value out of an
+// immutable node. Writers lock one shard, chosen by the key's hash. Replaced and deleted nodes, and
+// the slot arrays left behind when a shard grows, are freed only once every reader that could
+// still see them has left its epoch.
+//
+// A thread that has used a ConcurrentDict takes one of CDICT_MAX_THREADS reader slots. Call
+// cdict_thread_release() before the thread exits so the slot can be reused.
+
+#ifndef CDICT_MAX_THREADS
+#define CDICT_MAX_THREADS 128
+#endif
+
+typedef struct ConcurrentDict ConcurrentDict;
+
+// elem_size: size of a value. shard_count: rounded up to a power of two, 0 for the default (64).
+ConcurrentDict *cdict_new(size_t elem_size, int shard_count);
+void cdict_free(ConcurrentDict *cd); // no other thread may be using cd
+int cdict_count(ConcurrentDict *cd); // exact when no writer is active
+void cdict_thread_release(void);
+
+bool cdict__get(ConcurrentDict *cd, const void *key, size_t key_size, void *out);
+bool cdict__insert(ConcurrentDict *cd, const void *key, size_t key_size, const void *val);
+void cdict__put(ConcurrentDict *cd, const void *key, size_t key_size, const void *val);
+bool cdict__delete(ConcurrentDict *cd, const void *key, size_t key_size, void *out);
+
+// cdict_get: copies the value for key 'k' into '*out'. Returns false if the key is not present.
+#define cdict_get(cd, k, out) cdict__get((cd), (k), sizeof(*(k)), (out))
+// cdict_insert: adds key 'k' with the value at 'v'. Returns false, changing nothing, if it exists.
+#define cdict_insert(cd, k, v) cdict__insert((cd), (k), sizeof(*(k)), (v))
+// cdict_put: inserts or replaces the value for key 'k'.
+#define cdict_put(cd, k, v) cdict__put((cd), (k), sizeof(*(k)), (v))
+// cdict_delete: removes key 'k', copying its value to 'out' if out is not NULL. Returns false if absent.
+#define cdict_delete(cd, k, out) cdict__delete((cd), (k), sizeof(*(k)), (out))
+
+#define cdict_keystr_get(cd, k, key_size, out) cdict__get((cd), (k), (key_size), (out))
+#define cdict_keystr_insert(cd, k, key_size, v) cdict__insert((cd), (k), (key_size), (v))
+#define cdict_keystr_put(cd, k, key_size, v) cdict__put((cd), (k), (key_size), (v))
+#define cdict_keystr_delete(cd, k, key_size, out) cdict__delete((cd), (k), (key_size), (out))
+
+#endif /* DICT_CONCURRENT_H */
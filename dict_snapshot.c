@@ -0,0 +1,372 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "lib/darr.h"
+#include "dict.h"
+#include "dict_snapshot.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define SNAPSHOT_MAGIC "CDICTSNP"
+#define SNAPSHOT_VERSION 3 // 2: darr lengths are ptrdiff_t. 3: key records carry a cap
+#define SNAPSHOT_ENDIAN 0x01020304u
+#define SNAPSHOT_ALIGN 128 // the largest dict_init alignment
+#define SNAPSHOT_HASH_BUILTIN 0
+#define SNAPSHOT_HASH_MURMUR2 1
+
+typedef struct SnapshotSection {
+    uint64_t offset; // from the start of the file. 0 for an absent (NULL) array
+    uint64_t size;
+} SnapshotSection;
+
+// Every block is stored whole (its header included, for the dict and the darrs), at an offset
+// congruent to its old address modulo SNAPSHOT_ALIGN, so the alignment padding recorded before
+// data[] and before each darr's array is still right when the file is mapped at a page boundary.
+typedef struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian; // SNAPSHOT_ENDIAN as written by the saving machine
+    uint32_t engine; // dict__engine_id()
+    uint32_t layout; // sizeof(DictHdr) | sizeof(void *) << 16: a cheap check that the header structs match
+    uint64_t file_size;
+    uint64_t hash_id;
+    SnapshotSection dict, entries, ctrl, old_entries, keys, key_arena, free_list, live;
+    uint64_t data_checksum; // the sections, in the order above
+    uint64_t header_checksum; // this header, with header_checksum zeroed
+} SnapshotHeader;
+
+#define SNAPSHOT_P1 0x9e3779b185ebca87ull
+#define SNAPSHOT_P2 0xc2b2ae3d27d4eb4full
+static inline uint64_t snapshot__rotl(uint64_t x, int r){ return (x << r) | (x >> (64 - r)); }
+// Four independent multiply-rotate lanes over 32 bytes per step, so checking a multi-GB file runs
+// at close to memory bandwidth. Detects corruption; not meant to resist tampering.
+static uint64_t snapshot__checksum(const void *p, size_t n, uint64_t h){
+    const unsigned char *b = p;
+    uint64_t acc[4] = {h + SNAPSHOT_P1, h ^ SNAPSHOT_P2, h, h - SNAPSHOT_P1};
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        for (int l = 0; l < 4; l++) {
+            uint64_t w;
+            memcpy(&w, b + i + 8 * l, 8);
+            acc[l] = snapshot__rotl(acc[l] + w * SNAPSHOT_P2, 31) * SNAPSHOT_P1;
+        }
+    }
+    h = snapshot__rotl(acc[0], 1) + snapshot__rotl(acc[1], 7) + snapshot__rotl(acc[2], 12) + snapshot__rotl(acc[3], 18);
+    for (; i < n; i++) h = (h ^ b[i]) * SNAPSHOT_P1;
+    return dict__mix64(h ^ n);
+}
+// The dict and darr sections start with their header struct, which is checksummed on its own: on
+// save it is a patched copy (pointers cleared), the rest comes straight from the block in memory.
+static uint64_t snapshot__section_checksum(const void *head, size_t head_size, const void *block, size_t size, uint64_t sum){
+    if (head_size) sum = snapshot__checksum(head, head_size, sum);
+    return snapshot__checksum((const char *)block + head_size, size - head_size, sum);
+}
+static uint64_t snapshot__header_checksum(const SnapshotHeader *h){
+    SnapshotHeader copy = *h;
+    copy.header_checksum = 0;
+    return snapshot__checksum(&copy, sizeof(copy), 0);
+}
+
+///////////////////////
+// Saving
+///////////////////////
+typedef struct SnapshotBlock {
+    SnapshotSection *section;
+    const void *block; // where it lives in memory, for the padding rule above
+    const void *head; // replaces the first head_size bytes: the header with its pointers cleared
+    size_t head_size;
+} SnapshotBlock;
+
+static uint64_t snapshot__place(uint64_t pos, const void *block){
+    uint64_t start = (pos + SNAPSHOT_ALIGN - 1) & ~(uint64_t)(SNAPSHOT_ALIGN - 1);
+    return start + ((uintptr_t)block & (SNAPSHOT_ALIGN - 1));
+}
+static bool snapshot__write_zeros(FILE *f, uint64_t n){
+    static const char zeros[SNAPSHOT_ALIGN * 2];
+    return n == 0 || fwrite(zeros, 1, (size_t)n, f) == n;
+}
+// the darr block of 'arr', with the allocator (restored on open) cleared
+static void snapshot__darr_block(SnapshotBlock *b, SnapshotSection *s, void *arr, DarrHdr *head){
+    if (!arr) return;
+    *head = *darr__hdr(arr);
+    head->allocator = NULL;
+    *b = (SnapshotBlock){s, darr__hdr(arr), head, offsetof(DarrHdr, arr)};
+    s->size = head->size;
+}
+
+// Function: dict_save
+// Description: Writes 'dict' to 'path' in the format dict_mmap_open maps back in. The table is
+//              written as it is, tombstones and spare capacity included, so this is one pass of
+//              sequential writes. An empty (NULL) dict can't be saved.
+// Returns:
+//   bool - false if the file couldn't be written, or the dict uses a custom hash_fn.
+bool dict_save(void *dict, const char *path){
+    if (!dict) return false;
+    DictHdr *d = dict__hdr(dict);
+    SnapshotHeader h = {0};
+    memcpy(h.magic, SNAPSHOT_MAGIC, 8);
+    h.version = SNAPSHOT_VERSION;
+    h.endian = SNAPSHOT_ENDIAN;
+    h.engine = dict__engine_id();
+    h.layout = (uint32_t)(sizeof(DictHdr) | sizeof(void *) << 16);
+    if (!d->hash_fn) h.hash_id = SNAPSHOT_HASH_BUILTIN;
+    else if (d->hash_fn == dict_hash_murmur2) h.hash_id = SNAPSHOT_HASH_MURMUR2;
+    else return false;
+
+    DictHdr head = *d;
+    head.entries = NULL;
+    head.ctrl = NULL;
+    head.old_entries = NULL;
+    head.next_entries = NULL; // prepared again by later inserts
+    head.next_cap = 0;
+    head.next_init = 0;
+    head.keys = NULL;
+    head.key_arena = NULL;
+    head.free_list = NULL;
+    head.live = NULL;
+    head.hash_fn = NULL;
+    head.allocator = NULL;
+    DarrHdr arena_head, free_head;
+
+    SnapshotBlock blocks[8] = {0};
+    blocks[0] = (SnapshotBlock){&h.dict, d, &head, offsetof(DictHdr, data)};
+    h.dict.size = d->alloc_size;
+    blocks[1] = (SnapshotBlock){&h.entries, d->entries, NULL, 0};
+    h.entries.size = (uint64_t)d->cap * sizeof(DictEntry);
+    if (d->ctrl) {
+        blocks[2] = (SnapshotBlock){&h.ctrl, d->ctrl, NULL, 0};
+        h.ctrl.size = (uint64_t)d->cap;
+    }
+    if (d->old_entries) {
+        blocks[3] = (SnapshotBlock){&h.old_entries, d->old_entries, NULL, 0};
+        h.old_entries.size = (uint64_t)d->old_cap * sizeof(DictEntry);
+    }
+    blocks[4] = (SnapshotBlock){&h.keys, d->keys, NULL, 0};
+    h.keys.size = (uint64_t)d->cap * sizeof(DictKey);
+    snapshot__darr_block(&blocks[5], &h.key_arena, d->key_arena, &arena_head);
+    snapshot__darr_block(&blocks[6], &h.free_list, d->free_list, &free_head);
+    if (d->live) {
+        blocks[7] = (SnapshotBlock){&h.live, d->live, NULL, 0};
+        h.live.size = (uint64_t)dict__live_words(d->cap) * 8;
+    }
+    // lay the blocks out and checksum them as they will read in the file
+    uint64_t pos = sizeof(SnapshotHeader);
+    for (int i = 0; i < 8; i++) {
+        if (!blocks[i].section) continue;
+        SnapshotSection *s = blocks[i].section;
+        s->offset = snapshot__place(pos, blocks[i].block);
+        pos = s->offset + s->size;
+        h.data_checksum = snapshot__section_checksum(blocks[i].head, blocks[i].head_size, blocks[i].block, (size_t)s->size, h.data_checksum);
+    }
+    h.file_size = pos;
+    h.header_checksum = snapshot__header_checksum(&h);
+
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    pos = sizeof(SnapshotHeader);
+    for (int i = 0; ok && i < 8; i++) {
+        if (!blocks[i].section) continue;
+        SnapshotSection *s = blocks[i].section;
+        size_t body = (size_t)s->size - blocks[i].head_size;
+        ok = snapshot__write_zeros(f, s->offset - pos)
+          && (!blocks[i].head || fwrite(blocks[i].head, 1, blocks[i].head_size, f) == blocks[i].head_size)
+          && fwrite((const char *)blocks[i].block + blocks[i].head_size, 1, body, f) == body;
+        pos = s->offset + s->size;
+    }
+    ok = (fclose(f) == 0) && ok;
+    if (!ok) remove(path);
+    return ok;
+}
+
+///////////////////////
+// Opening
+///////////////////////
+// Owns the mapping of an opened snapshot and serves as the dict's allocator. Blocks inside the
+// mapping are never freed; growing one copies it out to the heap. The mapping goes away when the
+// dict's header block is freed, wherever it lives by then.
+typedef struct SnapshotMapping {
+    Allocator allocator; // ctx points back here
+    char *base;
+    size_t size;
+    void *header; // the current DictHdr block
+#if defined(_WIN32)
+    HANDLE file;
+    HANDLE map;
+#endif
+} SnapshotMapping;
+
+static bool snapshot__owns(SnapshotMapping *m, void *p){
+    return (char *)p >= m->base && (char *)p < m->base + m->size;
+}
+static void snapshot__unmap(SnapshotMapping *m){
+#if defined(_WIN32)
+    UnmapViewOfFile(m->base);
+    CloseHandle(m->map);
+    CloseHandle(m->file);
+#else
+    munmap(m->base, m->size);
+#endif
+    free(m);
+}
+static void *snapshot__alloc(void *ctx, size_t size){
+    (void)ctx;
+    return malloc(size);
+}
+static void *snapshot__realloc(void *ctx, void *ptr, size_t old_size, size_t new_size){
+    SnapshotMapping *m = ctx;
+    void *p;
+    if (ptr && snapshot__owns(m, ptr)) {
+        p = malloc(new_size);
+        if (p) memcpy(p, ptr, old_size < new_size ? old_size : new_size);
+    } else {
+        p = realloc(ptr, new_size);
+    }
+    if (p && ptr == m->header) m->header = p;
+    return p;
+}
+static void snapshot__free(void *ctx, void *ptr, size_t size){
+    SnapshotMapping *m = ctx;
+    (void)size;
+    bool header = ptr == m->header;
+    if (!snapshot__owns(m, ptr)) free(ptr);
+    if (header) snapshot__unmap(m); // dict__free releases the header last
+}
+
+static bool snapshot__section_ok(const SnapshotHeader *h, const SnapshotSection *s, uint64_t min_size){
+    if (!s->offset) return min_size == 0;
+    return s->offset >= sizeof(SnapshotHeader) && s->offset <= h->file_size && s->size <= h->file_size - s->offset
+        && s->size >= min_size;
+}
+// header fields that can be checked before touching the sections
+static bool snapshot__header_ok(const SnapshotHeader *h, uint64_t file_size){
+    return memcmp(h->magic, SNAPSHOT_MAGIC, 8) == 0 && h->version == SNAPSHOT_VERSION && h->endian == SNAPSHOT_ENDIAN
+        && h->engine == dict__engine_id() && h->layout == (uint32_t)(sizeof(DictHdr) | sizeof(void *) << 16)
+        && h->file_size == file_size && h->hash_id <= SNAPSHOT_HASH_MURMUR2 && h->header_checksum == snapshot__header_checksum(h);
+}
+// the sections must hold what the saved header says the dict has
+static bool snapshot__sections_ok(const SnapshotHeader *h, const DictHdr *d){
+    uint64_t cap = (uint64_t)d->cap;
+    bool ok = (cap >= 64 || (d->small && DICT_SMALL_CAP && cap == DICT_SMALL_CAP)) && (cap & (cap - 1)) == 0 && d->len >= 0 && d->len <= d->cap
+        && d->alignment >= 16 && d->alignment <= SNAPSHOT_ALIGN && (d->alignment & (d->alignment - 1)) == 0
+        && snapshot__section_ok(h, &h->dict, offsetof(DictHdr, data) + d->alignment + cap * d->elem_size) && d->alloc_size == h->dict.size
+        && snapshot__section_ok(h, &h->entries, cap * sizeof(DictEntry))
+        && snapshot__section_ok(h, &h->keys, cap * sizeof(DictKey));
+#if defined(DICT_SWISS)
+    if (!d->small) ok = ok && snapshot__section_ok(h, &h->ctrl, cap);
+#endif
+    if (!d->dense) ok = ok && snapshot__section_ok(h, &h->live, dict__live_words(cap) * 8);
+    if (h->old_entries.offset) ok = ok && snapshot__section_ok(h, &h->old_entries, (uint64_t)d->old_cap * sizeof(DictEntry));
+    ok = ok && snapshot__section_ok(h, &h->key_arena, 0) && snapshot__section_ok(h, &h->free_list, 0);
+    return ok;
+}
+// a darr stored in the file: checks its header against the section and points it at 'm'
+static bool snapshot__open_darr(SnapshotMapping *m, const SnapshotSection *s, size_t elem_size, void **arr){
+    *arr = NULL;
+    if (!s->offset) return true;
+    if (s->size < offsetof(DarrHdr, arr) + 16) return false;
+    DarrHdr *hdr = (DarrHdr *)(m->base + s->offset);
+    char *a = hdr->arr + ((16 - ((uintptr_t)hdr->arr & 15)) & 15); // as darr__grow aligns it
+    if (darr__hdr(a) != hdr || hdr->size != s->size || hdr->len < 0 || hdr->len > hdr->cap
+        || (uint64_t)(a - (char *)hdr) + (uint64_t)hdr->cap * elem_size > s->size) return false;
+    hdr->allocator = &m->allocator;
+    *arr = a;
+    return true;
+}
+
+// Function: dict_mmap_open
+// Description: Maps a file written by dict_save and returns the dict, ready to use. Only the header
+//              page is written to (to point the dict at the mapping); the checksums are verified
+//              before that, which reads the file once.
+// Returns:
+//   void * - the dict, to be released with dict_free. NULL if the file can't be opened or mapped,
+//            fails a check, or was written by an incompatible build.
+void *dict_mmap_open(const char *path){
+    SnapshotMapping *m = calloc(1, sizeof(SnapshotMapping));
+    if (!m) return NULL;
+#if defined(_WIN32)
+    m->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    LARGE_INTEGER file_size;
+    if (m->file == INVALID_HANDLE_VALUE || !GetFileSizeEx(m->file, &file_size) || (uint64_t)file_size.QuadPart < sizeof(SnapshotHeader)) {
+        if (m->file != INVALID_HANDLE_VALUE) CloseHandle(m->file);
+        free(m);
+        return NULL;
+    }
+    m->size = (size_t)file_size.QuadPart;
+    m->map = CreateFileMappingA(m->file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    m->base = m->map ? MapViewOfFile(m->map, FILE_MAP_COPY, 0, 0, 0) : NULL;
+    if (!m->base) {
+        if (m->map) CloseHandle(m->map);
+        CloseHandle(m->file);
+        free(m);
+        return NULL;
+    }
+#else
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(SnapshotHeader)) {
+        if (fd >= 0) close(fd);
+        free(m);
+        return NULL;
+    }
+    m->size = (size_t)st.st_size;
+    // MAP_PRIVATE: pages are shared with the page cache, and other processes, until written
+    void *base = mmap(NULL, m->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        free(m);
+        return NULL;
+    }
+    m->base = base;
+#endif
+    SnapshotHeader *h = (SnapshotHeader *)m->base;
+    DictHdr *d = (DictHdr *)(m->base + h->dict.offset);
+    if (!snapshot__header_ok(h, m->size) || !snapshot__section_ok(h, &h->dict, sizeof(DictHdr)) || !snapshot__sections_ok(h, d)) {
+        snapshot__unmap(m);
+        return NULL;
+    }
+    // the dict and darr headers were written with their pointers cleared, as they are in the file now
+    static const size_t head_sizes[] = {offsetof(DictHdr, data), 0, 0, 0, 0, offsetof(DarrHdr, arr), offsetof(DarrHdr, arr), 0};
+    const SnapshotSection *sections[] = {&h->dict, &h->entries, &h->ctrl, &h->old_entries, &h->keys, &h->key_arena, &h->free_list, &h->live};
+    uint64_t sum = 0;
+    for (int i = 0; i < 8; i++) {
+        if (!sections[i]->offset) continue;
+        const char *block = m->base + sections[i]->offset;
+        sum = snapshot__section_checksum(block, head_sizes[i], block, (size_t)sections[i]->size, sum);
+    }
+    if (sum != h->data_checksum) {
+        snapshot__unmap(m);
+        return NULL;
+    }
+
+    m->allocator = (Allocator){snapshot__alloc, snapshot__realloc, snapshot__free, m};
+    m->header = d;
+    void *key_arena, *free_list;
+    if (!snapshot__open_darr(m, &h->key_arena, 1, &key_arena) || !snapshot__open_darr(m, &h->free_list, sizeof(DictIdx), &free_list)) {
+        snapshot__unmap(m);
+        return NULL;
+    }
+    d->entries = (DictEntry *)(m->base + h->entries.offset);
+    d->ctrl = h->ctrl.offset ? (signed char *)(m->base + h->ctrl.offset) : NULL;
+    d->old_entries = h->old_entries.offset ? (DictEntry *)(m->base + h->old_entries.offset) : NULL;
+    d->keys = (DictKey *)(m->base + h->keys.offset);
+    d->key_arena = key_arena;
+    d->free_list = free_list;
+    d->live = h->live.offset ? (unsigned long long *)(m->base + h->live.offset) : NULL;
+    d->hash_fn = h->hash_id == SNAPSHOT_HASH_MURMUR2 ? dict_hash_murmur2 : NULL;
+    d->allocator = &m->allocator;
+    char *data = d->data + ((d->alignment - ((uintptr_t)d->data & (d->alignment - 1))) & (d->alignment - 1));
+    if (dict__hdr(data) != d) { // the padding byte before data[] disagrees
+        snapshot__unmap(m);
+        return NULL;
+    }
+    return data;
+}
@@ -0,0 +1,29 @@
+#ifndef DICT_SNAPSHOT_H
+#define DICT_SNAPSHOT_H
+#include <stdbool.h>
+
+// Snapshots write a dict to a file in a position-independent form and map it back in, so a large
+// dict can be loaded without re-inserting every key. The hashtable only stores indices, so the
+// entries, data[], key records, key bytes, free list and occupancy bitmap are written as they are,
+// each at an offset recorded in a versioned header. The header and the rest of the file each have
+// a checksum.
+//
+//     dict_save(d, "users.dict");
+//     ...
+//     User *users = dict_mmap_open("users.dict"); // NULL if the file is missing, corrupt or incompatible
+//     int idx = dict_get(users, &id);
+//     dict_free(users); // unmaps
+//
+// The mapping is copy-on-write. Pages are read from the page cache on first touch and shared
+// between processes mapping the same file until one of them writes to a page. Updates to the dict
+// work as usual: writes in place go to private copies of the touched pages, and anything that
+// grows is copied out to the heap. The file is never modified.
+//
+// A snapshot opens only in a build with the same engine, DICT_INCREMENTAL_GROW and DICT_LARGE
+// settings, pointer size and byte order. A dict with a custom hash_fn can't be saved, since a function pointer does
+// not survive the process; dict_hash_murmur2 is recognized and restored.
+
+bool dict_save(void *dict, const char *path); // false on I/O errors or an unsupported hash_fn
+void *dict_mmap_open(const char *path);
+
+#endif /* DICT_SNAPSHOT_H */
@@ -0,0 +1,159 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // mremap
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include "allocator.h"
+#if defined(__linux__) && ALLOCATOR_MAP_MIN
+#include <sys/mman.h>
+#define ALLOCATOR_MAP 1
+#define ALLOCATOR_HUGE_PAGE ((size_t)2 << 20)
+#endif
+
+#define ARENA_DEFAULT_CHUNK (1 << 20)
+#define ARENA_ALIGN 16
+
+struct ArenaChunk {
+    ArenaChunk *next;
+    size_t cap;
+    size_t used;
+    size_t last; // offset of the latest allocation, so it can grow or be freed in place
+    _Alignas(16) char data[];
+};
+
+#if defined(ALLOCATOR_MAP)
+// The default allocator. Blocks of ALLOCATOR_MAP_MIN bytes or more are mapped directly, rounded up
+// to a huge page and marked for transparent huge pages. Growing one is an mremap, which moves page
+// table entries instead of copying the data through realloc. Whether a block is mapped follows from
+// its size, so callers must pass the same size to free that they allocated with.
+static size_t heap__map_size(size_t size){ return (size + ALLOCATOR_HUGE_PAGE - 1) & ~(ALLOCATOR_HUGE_PAGE - 1); }
+static bool heap__mapped(size_t size){ return size >= ALLOCATOR_MAP_MIN; }
+static void *heap__map(size_t size){
+    void *p = mmap(NULL, heap__map_size(size), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return NULL;
+    madvise(p, heap__map_size(size), MADV_HUGEPAGE); // only a hint, fails quietly without THP
+    return p;
+}
+static void heap__free(void *ptr, size_t size){
+    if (heap__mapped(size)) munmap(ptr, heap__map_size(size));
+    else free(ptr);
+}
+static void *heap__alloc(size_t size){ return heap__mapped(size) ? heap__map(size) : malloc(size); }
+static void *heap__realloc(void *ptr, size_t old_size, size_t new_size){
+    bool was_mapped = ptr && heap__mapped(old_size);
+    if (!was_mapped && !heap__mapped(new_size)) return realloc(ptr, new_size);
+    if (was_mapped && heap__mapped(new_size)) {
+        void *p = mremap(ptr, heap__map_size(old_size), heap__map_size(new_size), MREMAP_MAYMOVE);
+        if (p == MAP_FAILED) return NULL;
+        madvise(p, heap__map_size(new_size), MADV_HUGEPAGE);
+        return p;
+    }
+    void *p = heap__alloc(new_size); // crossing ALLOCATOR_MAP_MIN one way or the other
+    if (p && ptr) {
+        memcpy(p, ptr, old_size < new_size ? old_size : new_size);
+        heap__free(ptr, old_size);
+    }
+    return p;
+}
+#else
+#define heap__alloc(size) malloc(size)
+#define heap__realloc(ptr, old_size, new_size) realloc((ptr), (new_size))
+#define heap__free(ptr, size) free(ptr)
+#endif
+
+void *allocator_alloc(const Allocator *a, size_t size){
+    void *p = a ? a->alloc(a->ctx, size) : heap__alloc(size);
+    if (!p) {
+        perror("malloc failed");
+        exit(1);
+    }
+    return p;
+}
+void *allocator_realloc(const Allocator *a, void *ptr, size_t old_size, size_t new_size){
+    void *p = a ? a->realloc(a->ctx, ptr, old_size, new_size) : heap__realloc(ptr, old_size, new_size);
+    if (!p) {
+        perror("realloc failed");
+        exit(1);
+    }
+    return p;
+}
+void allocator_free(const Allocator *a, void *ptr, size_t size){
+    if (!ptr) return;
+    if (a) a->free(a->ctx, ptr, size);
+    else heap__free(ptr, size);
+}
+
+static size_t arena__align(size_t n){ return (n + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1); }
+
+// Moves on to the next chunk that can hold 'size' bytes, reusing chunks kept by arena_reset.
+static ArenaChunk *arena__chunk_for(Arena *arena, size_t size){
+    ArenaChunk *c = arena->current;
+    if (c && c->cap - c->used >= size) return c;
+    while (c && c->next) {
+        c = c->next;
+        if (c->cap - c->used >= size) return arena->current = c;
+    }
+    size_t chunk_size = arena->chunk_size ? arena->chunk_size : ARENA_DEFAULT_CHUNK;
+    if (size > chunk_size) chunk_size = size;
+    ArenaChunk *n = malloc(offsetof(ArenaChunk, data) + chunk_size);
+    if (!n) return NULL;
+    n->next = NULL;
+    n->cap = chunk_size;
+    n->used = 0;
+    n->last = 0;
+    if (c) c->next = n;
+    else arena->first = n;
+    return arena->current = n;
+}
+static void *arena__alloc(void *ctx, size_t size){
+    Arena *arena = ctx;
+    size = arena__align(size);
+    ArenaChunk *c = arena__chunk_for(arena, size);
+    if (!c) return NULL;
+    c->last = c->used;
+    c->used += size;
+    return c->data + c->last;
+}
+static bool arena__is_last(ArenaChunk *c, void *ptr){
+    return c && c->used > 0 && (char *)ptr == c->data + c->last;
+}
+static void *arena__realloc(void *ctx, void *ptr, size_t old_size, size_t new_size){
+    Arena *arena = ctx;
+    if (!ptr) return arena__alloc(ctx, new_size);
+    ArenaChunk *c = arena->current;
+    if (arena__is_last(c, ptr) && c->last + arena__align(new_size) <= c->cap) {
+        c->used = c->last + arena__align(new_size); // the latest allocation grows in place
+        return ptr;
+    }
+    void *p = arena__alloc(ctx, new_size);
+    if (p) memcpy(p, ptr, old_size < new_size ? old_size : new_size);
+    return p;
+}
+static void arena__free(void *ctx, void *ptr, size_t size){
+    Arena *arena = ctx;
+    (void)size;
+    ArenaChunk *c = arena->current;
+    if (arena__is_last(c, ptr)) c->used = c->last;
+}
+
+Allocator arena_allocator(Arena *arena){
+    return (Allocator){arena__alloc, arena__realloc, arena__free, arena};
+}
+void arena_reset(Arena *arena){
+    for (ArenaChunk *c = arena->first; c; c = c->next) {
+        c->used = 0;
+        c->last = 0;
+    }
+    arena->current = arena->first;
+}
+void arena_free(Arena *arena){
+    ArenaChunk *c = arena->first;
+    while (c) {
+        ArenaChunk *next = c->next;
+        free(c);
+        c = next;
+    }
+    arena->first = arena->current = NULL;
+}
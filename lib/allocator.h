@@ -0,0 +1,49 @@
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+#include <stddef.h>
+
+// An allocator interface for darr and dict. Every call gets the size of the block, so an 
+// allocator doesn't need to keep per-block headers. A NULL Allocator pointer means malloc/realloc/free.
+typedef struct Allocator {
+    void *(*alloc)(void *ctx, size_t size); // 16 byte aligned
+    void *(*realloc)(void *ctx, void *ptr, size_t old_size, size_t new_size);
+    void (*free)(void *ctx, void *ptr, size_t size);
+    void *ctx;
+} Allocator;
+
+// Blocks of ALLOCATOR_MAP_MIN bytes or more from the default allocator are mmap'd on Linux, with
+// transparent huge pages, and grow with mremap instead of a copy. 0 turns that off; large dicts
+// (DICT_LARGE) default to 64 MB. Define it the same way for every file, like DICT_LARGE.
+#if !defined(ALLOCATOR_MAP_MIN)
+#if defined(DICT_LARGE)
+#define ALLOCATOR_MAP_MIN (64ull << 20)
+#else
+#define ALLOCATOR_MAP_MIN 0
+#endif
+#endif
+
+// These abort with perror like the rest of the library when memory runs out.
+void *allocator_alloc(const Allocator *a, size_t size);
+void *allocator_realloc(const Allocator *a, void *ptr, size_t old_size, size_t new_size);
+void allocator_free(const Allocator *a, void *ptr, size_t size);
+
+// A bump allocator. Blocks are carved out of large chunks; free only gives memory back when it 
+// is the latest allocation, and arena_reset releases everything at once while keeping the chunks.
+// Handy for many short-lived dicts:
+//     Arena arena = {0};
+//     Allocator alloc = arena_allocator(&arena);
+//     dict_init(d, .allocator = &alloc);
+//     ...
+//     arena_reset(&arena); // every dict allocated from it is gone, don't dict_free them
+typedef struct ArenaChunk ArenaChunk;
+typedef struct Arena {
+    ArenaChunk *first;
+    ArenaChunk *current;
+    size_t chunk_size; // 0: 1 MB. Larger requests get a chunk of their own size.
+} Arena;
+
+Allocator arena_allocator(Arena *arena);
+void arena_reset(Arena *arena);
+void arena_free(Arena *arena); // returns the chunks to malloc
+
+#endif /* ALLOCATOR_H */
@@ -1,4 +1,6 @@
 #include <stdlib.h>  
+#include <stddef.h> 
+#include <stdint.h> 
 #include <stdarg.h> 
 #include <stdio.h> 
 #include "darr.h"
@@ -11,23 +13,34 @@
 #define MAX(x, y) ((x) >= (y) ? (x) : (y))
 
 DarrHdr *darr__hdr(void *arr) { return (DarrHdr*)( (char*)(arr) - offsetof(DarrHdr, arr) - *((char*)(arr) - 1)); }
-void darr__free(void *a){ free(darr__hdr(a)); }
+void darr__free(void *a){ 
+    DarrHdr *hdr = darr__hdr(a);
+    allocator_free(hdr->allocator, hdr, hdr->size); 
+}
 
-void *darr__init(void *arr, unsigned int initial_capacity, float growth_factor, int elem_size){
+// bytes for a header and 'cap' elements. Exits when that would wrap around, like a failed allocation.
+static size_t darr__size(size_t cap, size_t elem_size){
+    if (elem_size && cap > (PTRDIFF_MAX - offsetof(DarrHdr, arr) - 16) / elem_size) {
+        fprintf(stderr, "darr: %zu elements of %zu bytes are too many\n", cap, elem_size);
+        exit(1);
+    }
+    return offsetof(DarrHdr, arr) + cap * elem_size + 16; // add 16 for alignment padding
+}
+void *darr__init(void *arr, size_t initial_capacity, float growth_factor, size_t elem_size){
+    return darr__init_alloc(arr, initial_capacity, growth_factor, elem_size, NULL);
+}
+void *darr__init_alloc(void *arr, size_t initial_capacity, float growth_factor, size_t elem_size, const Allocator *allocator){
     if(arr) assert(0 && "unreachable - darr__init: array already exists");
     assert(growth_factor == 0 || growth_factor > 1.0);
 
-    int new_cap = initial_capacity ? initial_capacity : 16;
-    int new_size = offsetof(DarrHdr, arr) + new_cap * elem_size + 16; // add 16 bits for alignment padding
+    size_t new_cap = initial_capacity ? initial_capacity : 16;
+    size_t new_size = darr__size(new_cap, elem_size);
 
-    DarrHdr *new_hdr;
-    new_hdr = malloc(new_size);
-    if (!new_hdr) {
-        perror("malloc failed");
-        exit(1);
-    }
+    DarrHdr *new_hdr = allocator_alloc(allocator, new_size);
+    new_hdr->allocator = allocator;
+    new_hdr->size = new_size;
     new_hdr->len = 0;
-    new_hdr->cap = new_cap;
+    new_hdr->cap = (ptrdiff_t)new_cap;
     new_hdr->growth_factor = growth_factor ? growth_factor : 2;
     new_hdr->min_size = new_cap;
     // todo - don't use modulo to align data, use bitwise ops
@@ -36,11 +49,9 @@ void *darr__init(void *arr, unsigned int initial_capacity, float growth_factor,
     *(aligned_data - 1) = alignment_padding; // store amount of padding at aligned_data - 1
     return aligned_data;
 }
-void *darr__grow(void *arr, unsigned int new_len, unsigned int elem_size) {
-    assert(darr_cap(arr) <= (SIZE_MAX - 1)/2);
-
-    unsigned int new_cap; 
-    unsigned int  min_size = 16;
+void *darr__grow(void *arr, size_t new_len, size_t elem_size) {
+    size_t new_cap; 
+    size_t min_size = 16;
     float growth_factor = 2.0f;
     if(arr){
         // override defaults
@@ -48,28 +59,23 @@ void *darr__grow(void *arr, unsigned int new_len, unsigned int elem_size) {
         min_size = darr__hdr(arr)->min_size > 0 ? darr__hdr(arr)->min_size : min_size;
     }    
     // new_len is set either from darr_printf or darr_fit
-    new_cap = MAX(min_size, MAX((unsigned int)(growth_factor * (float)darr_cap(arr)), new_len)); 
+    new_cap = MAX(min_size, MAX((size_t)(growth_factor * (double)darr_cap(arr)), new_len)); 
 
     assert(new_len <= new_cap); 
-    int new_size = offsetof(DarrHdr, arr) + (new_cap * elem_size) + 16; // add 16 for alignment padding
+    size_t new_size = darr__size(new_cap, elem_size);
     DarrHdr *new_hdr;
     if (arr) {
-        new_hdr = realloc(darr__hdr(arr), new_size);
-        if (!new_hdr) {
-            perror("realloc failed");
-            exit(1);
-        }
+        DarrHdr *hdr = darr__hdr(arr);
+        new_hdr = allocator_realloc(hdr->allocator, hdr, hdr->size, new_size);
     } else {
-        new_hdr = malloc(new_size);
-        if (!new_hdr) {
-            perror("malloc failed");
-            exit(1);
-        }
+        new_hdr = allocator_alloc(NULL, new_size);
+        new_hdr->allocator = NULL;
         new_hdr->len = 0;
         new_hdr->growth_factor = growth_factor;
         new_hdr->min_size = min_size;
     }   
-    new_hdr->cap = new_cap;
+    new_hdr->cap = (ptrdiff_t)new_cap;
+    new_hdr->size = new_size;
     // todo - don't use modulo to align data, use bitwise ops
     char alignment_padding = (16 - ((unsigned long long)new_hdr->arr & 15)) & 15; // Align data[]
     char *aligned_data = new_hdr->arr + alignment_padding;
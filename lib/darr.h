@@ -4,12 +4,17 @@
 // the dynamic array was originally written by Per Vognsen, from his wonderful Bitwise series:
 // https://www.youtube.com/playlist?list=PLU94OURih-CiP4WxKSMt3UcwMSDM3aTtX
 // based on Sean Barrett's stretchy buffers https://github.com/nothings/stb
+#include <stddef.h>
+#include "allocator.h"
 
+// len and cap are ptrdiff_t, so an array can pass 2^31 elements (a large dict's key arena does)
 typedef struct DarrHdr { 
-    int len;
-    int cap;
+    ptrdiff_t len;
+    ptrdiff_t cap;
     float growth_factor; 
-    unsigned int min_size; 
+    size_t min_size; 
+    const Allocator *allocator; // NULL: malloc. Set by darr_init_alloc, kept across grows
+    size_t size; // bytes allocated for the header and array
     char alignment_padding;
     char arr[]; 
 } DarrHdr;
@@ -17,29 +22,32 @@ typedef struct DarrHdr {
 DarrHdr *darr__hdr(void *arr);
 void darr__free(void *a);
 
-static inline int darr_len(void *a);
-static inline int darr_cap(void *a);
+static inline ptrdiff_t darr_len(void *a);
+static inline ptrdiff_t darr_cap(void *a);
 static inline void darr_clear(void *a);
 
-void *darr__grow(void *arr, unsigned int new_len, unsigned int elem_size);
-void *darr__init(void *arr, unsigned int initial_capacity, float growth_factor, int elem_size);
+void *darr__grow(void *arr, size_t new_len, size_t elem_size);
+void *darr__init(void *arr, size_t initial_capacity, float growth_factor, size_t elem_size);
+void *darr__init_alloc(void *arr, size_t initial_capacity, float growth_factor, size_t elem_size, const Allocator *allocator);
 char *darr__printf(char *arr, const char *fmt, ...);
 
 #define darr_end(a) ((a) + darr_len(a))
 #define darr_free(a) ((a) ? (darr__free(a), (a) = ((void *)0), 1) : 0) // NULL = ((void *)0))
-#define darr_fit(a, n) ((n) <= darr_cap(a) ? 0 : ((a) = darr__grow((a), (n), sizeof(*(a)))))
+#define darr_fit(a, n) ((ptrdiff_t)(n) <= darr_cap(a) ? 0 : ((a) = darr__grow((a), (n), sizeof(*(a)))))
 
 #define darr_push(a, ...) (darr_fit((a), 1 + darr_len(a)), (a)[darr__hdr(a)->len] = (__VA_ARGS__), darr__hdr(a)->len++) // returns idx
 #define darr_printf(a, ...) ((a) = darr__printf((a), __VA_ARGS__))
 // optional init: allow users to define initial capacity and growth factor
 // myarr = darr_init(myarr, 255, 0, 0); //  zero's indicates the user will use default values
 #define darr_init(a, initial_capacity, growth_factor) ((a) = darr__init((a), initial_capacity, growth_factor, sizeof(*(a)))) 
+// same, with the memory coming from 'allocator' (see allocator.h) for the life of the array
+#define darr_init_alloc(a, initial_capacity, growth_factor, allocator) ((a) = darr__init_alloc((a), initial_capacity, growth_factor, sizeof(*(a)), (allocator))) 
 
 #define darr_pop(a) ((a)[darr__hdr(a)->len-- - 1]) 
 #define darr_peek(a) ((a)[darr__hdr(a)->len - 1] ) // it's up to the user to null check etc.
 
-static inline int darr_len(void *a) { return a ? darr__hdr(a)->len : 0; }
-static inline int darr_cap(void *a) { return a ? darr__hdr(a)->cap : 0; }
+static inline ptrdiff_t darr_len(void *a) { return a ? darr__hdr(a)->len : 0; }
+static inline ptrdiff_t darr_cap(void *a) { return a ? darr__hdr(a)->cap : 0; }
 static inline void darr_clear(void *a) { if (a)  darr__hdr(a)->len = 0; }
 
 #endif /* DARR_H */
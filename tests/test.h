@@ -0,0 +1,33 @@
+#ifndef DICT_TEST_H
+#define DICT_TEST_H
+#include <stdio.h>
+#include <stdlib.h>
+
+// stops the run at the first failure. Exits with 2, so it is never mistaken for the library giving up (1)
+#define CHECK(x) do { if (!(x)) { fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #x); exit(2); } } while (0)
+
+unsigned long long test_rand(void); // xorshift64, the same sequence every run
+// Runs 'fn' in a child process and checks that it exits with status 1, which is how the library 
+// reports sizes it can't allocate. Does nothing where there is no fork.
+void test_expect_exit(void (*fn)(void));
+// A file name in the working directory, unique to this process where there is a pid to go by.
+void test_temp_path(char *path, size_t size, const char *suffix);
+
+void test_large(void);
+void test_iter(void);
+void test_keys(void);
+void test_capacity(void);
+void test_engines(void);
+void test_hash(void);
+void test_batch(void);
+void test_concurrent(void);
+void test_init(void);
+void test_dense(void);
+void test_snapshot(void);
+void test_stats(void);
+void test_shrink(void);
+void test_small(void);
+void test_upsert(void);
+void test_build(void);
+
+#endif /* DICT_TEST_H */
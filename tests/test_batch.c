@@ -0,0 +1,64 @@
+// dict_get_many / dict_insert_many / dict_delete_many against the one-key calls.
+#include "dict.h"
+#include "test.h"
+
+static DictHash same_hash(const void *key, size_t key_size, unsigned long long seed){
+    (void)key; (void)key_size; (void)seed;
+    return 7;
+}
+
+static void matches_single_calls(void){
+    enum { N = 10000 };
+    static long long keys[N], vals[N];
+    static DictIdx out[N];
+    for (int i = 0; i < N; i++) { keys[i] = i * 3; vals[i] = i; }
+    long long *d = NULL;
+    dict_insert_many(d, keys, vals, N, out);
+    for (int i = 0; i < N; i++) CHECK(out[i] >= 0 && d[out[i]] == i);
+    dict_insert_many(d, keys, vals, 10, out); // already there
+    for (int i = 0; i < 10; i++) CHECK(out[i] == -1);
+    dict_get_many(d, keys, N, out);
+    for (int i = 0; i < N; i++) CHECK(out[i] == dict_get(d, &keys[i]) && d[out[i]] == i);
+    dict_delete_many(d, keys, N / 2, out);
+    for (int i = 0; i < N / 2; i++) CHECK(out[i] >= 0);
+    CHECK(dict_count(d) == N - N / 2);
+    dict_delete_many(d, keys, N / 2, NULL); // gone already
+    CHECK(dict_count(d) == N - N / 2);
+    dict_get_many(d, keys, N, out);
+    for (int i = 0; i < N; i++) CHECK(i < N / 2 ? out[i] == -1 : d[out[i]] == i);
+    dict_free(d);
+    long long *empty = NULL;
+    dict_get_many(empty, keys, 5, out);
+    CHECK(out[4] == -1);
+}
+// repeated keys within one batch: the first copy is inserted, the rest report -1
+static void duplicates_in_batch(void){
+    long long keys[] = {5, 6, 5, 7, 6, 5};
+    long long vals[] = {50, 60, 51, 70, 61, 52};
+    DictIdx out[6];
+    long long *d = NULL;
+    dict_insert_many(d, keys, vals, 6, out);
+    CHECK(out[0] >= 0 && out[1] >= 0 && out[3] >= 0);
+    CHECK(out[2] == -1 && out[4] == -1 && out[5] == -1);
+    CHECK(dict_count(d) == 3 && d[dict_get(d, &keys[0])] == 50);
+    dict_free(d);
+}
+static void colliding_batch(void){
+    int *d = NULL;
+    dict_init(d, .hash_fn = same_hash);
+    int keys[500];
+    DictIdx out[500];
+    for (int i = 0; i < 500; i++) { keys[i] = i; dict_insert(d, &i, i * 2); }
+    dict_get_many(d, keys, 500, out);
+    for (int i = 0; i < 500; i++) CHECK(d[out[i]] == i * 2);
+    keys[0] = -5;
+    dict_get_many(d, keys, 1, out);
+    CHECK(out[0] == -1);
+    dict_free(d);
+}
+
+void test_batch(void){
+    matches_single_calls();
+    duplicates_in_batch();
+    colliding_batch();
+}
@@ -0,0 +1,113 @@
+// dict_build_from_arrays and parallel rehashes. The threads configuration runs these on real
+// threads, with DICT_PARALLEL_REHASH_MIN lowered so the rehashes here go parallel too.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dict.h"
+#include "lib/allocator.h"
+#include "test.h"
+
+typedef struct { long long k, v; } Pair;
+
+static int cmp_ll(const void *a, const void *b){
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+static int first_of(const long long *keys, int n, long long k){
+    for (int i = 0; i < n; i++) if (keys[i] == k) return i;
+    return -1;
+}
+static void check_built(Pair *d, long long *keys, int n, long long universe, bool dense){
+    long long *sorted = malloc(sizeof(long long) * (size_t)n);
+    memcpy(sorted, keys, sizeof(long long) * (size_t)n);
+    qsort(sorted, (size_t)n, sizeof(long long), cmp_ll);
+    DictIdx unique = 0;
+    for (int i = 0; i < n; i++) if (i == 0 || sorted[i] != sorted[i - 1]) unique++;
+    CHECK(dict_count(d) == unique);
+    for (int j = 0; j < n; j++) {
+        DictIdx i = dict_get(d, &keys[j]);
+        CHECK(i >= 0 && d[i].k == keys[j]);
+        if (n > 5000) continue; // first_of is quadratic
+        CHECK(d[i].v == first_of(keys, n, keys[j])); // the first copy of a key wins
+        if (!dense) CHECK(i == d[i].v);
+    }
+    for (int t = 0; t < 1000; t++) {
+        long long k = (long long)(test_rand() % (unsigned long long)universe) + universe;
+        CHECK(dict_get(d, &k) == -1);
+    }
+    DictIdx seen = 0;
+    dict_foreach(d, i) {
+        CHECK(bsearch(&d[i].k, sorted, (size_t)n, sizeof(long long), cmp_ll));
+        seen++;
+    }
+    CHECK(seen == unique);
+    if (dense) CHECK(dict_range(d) == unique);
+    free(sorted);
+}
+static void build(int n, long long universe, bool dense, int threads, const Allocator *a){
+    long long *keys = malloc(sizeof(long long) * (size_t)n);
+    Pair *vals = malloc(sizeof(Pair) * (size_t)n);
+    for (int i = 0; i < n; i++) {
+        keys[i] = (long long)(test_rand() % (unsigned long long)universe);
+        vals[i] = (Pair){keys[i], i};
+    }
+    Pair *d = NULL;
+    if (dense || a || test_rand() % 2) dict_init(d, .dense = dense, .allocator = a, .threads = threads);
+    dict_build_from_arrays(d, keys, vals, n, threads);
+    check_built(d, keys, n, universe, dense);
+    for (int it = 0; it < 2000; it++) { // keeps working as an ordinary dict
+        long long k = (long long)(test_rand() % (unsigned long long)universe);
+        if (test_rand() % 2) dict_delete(d, &k);
+        else dict_insert(d, &k, ((Pair){k, -1}));
+        DictIdx i = dict_get(d, &k);
+        if (i >= 0) CHECK(d[i].k == k);
+    }
+    dict_free(d);
+    free(keys);
+    free(vals);
+}
+static void wide_keys_no_vals(void){
+    enum { N = 20000, UNIQUE = 15000 };
+    typedef struct { char b[24]; } Key;
+    Key *keys = calloc(N, sizeof(Key));
+    for (int i = 0; i < N; i++) snprintf(keys[i].b, sizeof(keys[i].b), "key-%d", i % UNIQUE);
+    int *d = NULL;
+    dict_build_from_arrays(d, keys, NULL, N, 4);
+    CHECK(dict_count(d) == UNIQUE);
+    for (int i = 0; i < N; i++) CHECK(dict_get(d, &keys[i]) == i % UNIQUE);
+    dict_free(d);
+    free(keys);
+}
+static void parallel_rehash(void){
+    enum { N = 100000 };
+    long long *d = NULL;
+    dict_init(d, .threads = 4);
+    for (long long i = 0; i < N; i++) dict_insert(d, &i, i * 2);
+    for (long long i = 0; i < N; i += 3) dict_delete(d, &i);
+    for (long long i = N; i < 2 * N; i++) dict_insert(d, &i, i * 2);
+    for (long long i = 0; i < 2 * N; i++) {
+        DictIdx x = dict_get(d, &i);
+        CHECK(i < N && i % 3 == 0 ? x == -1 : x >= 0 && d[x] == i * 2);
+    }
+    dict_free(d);
+}
+
+void test_build(void){
+    static const int threads[] = {1, 3, 8};
+    for (int t = 0; t < 3; t++) {
+        build(10, 1000, false, threads[t], NULL);
+        build(15, 5, false, threads[t], NULL);
+        build(1000, 1000000, false, threads[t], NULL);
+        build(5000, 3000, false, threads[t], NULL);
+        build(5000, 3000, true, threads[t], NULL);
+        build(30000, 1ll << 40, false, threads[t], NULL);
+        build(30000, 20000, true, threads[t], NULL);
+        Arena arena = {0};
+        arena.chunk_size = 1 << 16;
+        Allocator a = arena_allocator(&arena);
+        build(20000, 15000, false, threads[t], &a);
+        arena_free(&arena);
+    }
+    wide_keys_no_vals();
+    parallel_rehash();
+}
@@ -0,0 +1,50 @@
+// Power-of-two capacities and Fibonacci home slots.
+#include "dict.h"
+#include "test.h"
+
+static DictHash identity_hash(const void *key, size_t key_size, unsigned long long seed){
+    (void)key_size; (void)seed;
+    return *(const DictHash *)key;
+}
+
+static void power_of_two(void){
+    int *d = NULL;
+    DictIdx last_cap = 0;
+    int grows = 0;
+    for (int k = 0; k < 100000; k++) {
+        dict_insert(d, &k, k);
+        DictIdx cap = dict_cap(d);
+        CHECK(cap > 0 && (cap & (cap - 1)) == 0);
+        CHECK(dict_count(d) <= cap);
+        if (cap != last_cap) grows++;
+        last_cap = cap;
+    }
+    CHECK(grows < 20); // doubling, not creeping
+    for (int k = 0; k < 100000; k++) CHECK(d[dict_get(d, &k)] == k);
+    dict_free(d);
+}
+// With an identity hash, multiples of 4096 share all their low bits. Taking the home slot from 
+// the top bits of hash * 2^w/phi still spreads them, so almost every key sits at or next to home.
+static void strided_keys_spread(void){
+    DictHash *d = NULL;
+    dict_init(d, .hash_fn = identity_hash);
+    enum { KEYS = 10000 };
+    for (DictHash k = 1; k <= KEYS; k++) {
+        DictHash key = k * 4096;
+        CHECK(dict_insert(d, &key, k) >= 0);
+    }
+    for (DictHash k = 1; k <= KEYS; k++) {
+        DictHash key = k * 4096;
+        CHECK(d[dict_get(d, &key)] == k);
+    }
+    DictStats st;
+    dict_stats(d, &st);
+    CHECK(st.len == KEYS);
+    CHECK(st.hit_probes[0] + st.hit_probes[1] + st.hit_probes[2] > KEYS * 9 / 10);
+    dict_free(d);
+}
+
+void test_capacity(void){
+    power_of_two();
+    strided_keys_spread();
+}
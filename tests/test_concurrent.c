@@ -0,0 +1,63 @@
+// ConcurrentDict: writers and readers on shared keys, then the single-threaded semantics.
+#include <pthread.h>
+#include "dict_concurrent.h"
+#include "test.h"
+
+#define KEYS 5000
+#define THREADS 4
+static ConcurrentDict *shared;
+
+// every value ever stored for key k is k * 3, so a reader can check any value it sees
+static void *worker(void *arg){
+    unsigned long long s = (unsigned long long)(size_t)arg * 7919 + 1;
+    for (int i = 0; i < 40000; i++) {
+        s ^= s << 13; s ^= s >> 7; s ^= s << 17;
+        unsigned long long k = s % KEYS;
+        long long v = (long long)k * 3, out;
+        int op = (int)((s >> 40) % 10);
+        if (op == 0) cdict_put(shared, &k, &v);
+        else if (op == 1) cdict_delete(shared, &k, NULL);
+        else if (cdict_get(shared, &k, &out)) CHECK(out == (long long)k * 3);
+    }
+    cdict_thread_release();
+    return NULL;
+}
+static void threads(void){
+    shared = cdict_new(sizeof(long long), THREADS);
+    pthread_t t[THREADS];
+    for (size_t i = 0; i < THREADS; i++) CHECK(pthread_create(&t[i], NULL, worker, (void *)i) == 0);
+    for (int i = 0; i < THREADS; i++) pthread_join(t[i], NULL);
+    int found = 0;
+    for (unsigned long long k = 0; k < KEYS; k++) {
+        long long out;
+        if (cdict_get(shared, &k, &out)) { CHECK(out == (long long)k * 3); found++; }
+    }
+    CHECK(found == cdict_count(shared));
+    cdict_free(shared);
+}
+static void semantics(void){
+    ConcurrentDict *cd = cdict_new(sizeof(long long), 0);
+    unsigned long long k = 5;
+    long long one = 1, two = 2, out = 0;
+    CHECK(!cdict_get(cd, &k, &out));
+    CHECK(cdict_insert(cd, &k, &one));
+    CHECK(!cdict_insert(cd, &k, &two)); // insert doesn't replace
+    CHECK(cdict_get(cd, &k, &out) && out == 1);
+    cdict_put(cd, &k, &two); // put does
+    CHECK(cdict_get(cd, &k, &out) && out == 2);
+    CHECK(cdict_delete(cd, &k, &out) && out == 2);
+    CHECK(!cdict_delete(cd, &k, NULL) && cdict_count(cd) == 0);
+    for (unsigned long long i = 0; i < 20000; i++) { long long v = (long long)i; cdict_put(cd, &i, &v); } // outgrows the slot arrays
+    for (unsigned long long i = 0; i < 20000; i++) CHECK(cdict_get(cd, &i, &out) && out == (long long)i);
+    cdict_keystr_put(cd, "hello", 5, &one);
+    CHECK(cdict_keystr_get(cd, "hello", 5, &out) && out == 1);
+    CHECK(!cdict_keystr_get(cd, "hell", 4, &out));
+    CHECK(cdict_count(cd) == 20001);
+    cdict_free(cd);
+    cdict_thread_release();
+}
+
+void test_concurrent(void){
+    threads();
+    semantics();
+}
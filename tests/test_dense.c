@@ -0,0 +1,54 @@
+// Dense dicts: deleting moves the last value into the hole, so data[0..count) is always packed.
+#include <string.h>
+#include "dict.h"
+#include "test.h"
+
+static void packed_under_churn(void){
+    enum { KEYS = 3000 };
+    static bool present[KEYS];
+    memset(present, 0, sizeof(present));
+    long long *d = NULL;
+    dict_init(d, .dense = true);
+    for (int it = 0; it < 100000; it++) {
+        long long k = (long long)(test_rand() % KEYS);
+        if (test_rand() % 3) {
+            CHECK((dict_insert(d, &k, k * 7) >= 0) == !present[k]);
+            present[k] = true;
+        } else {
+            DictIdx hole = dict_delete(d, &k);
+            CHECK((hole >= 0) == present[k]);
+            CHECK(hole < 0 || hole <= dict_count(d));
+            present[k] = false;
+        }
+    }
+    DictIdx count = 0;
+    for (int k = 0; k < KEYS; k++) count += present[k];
+    CHECK(count == dict_count(d) && dict_range(d) == count);
+    for (DictIdx i = 0; i < dict_count(d); i++) { // a plain loop sees only live values
+        long long k = d[i] / 7;
+        CHECK(present[k] && dict_get(d, &k) == i);
+    }
+    dict_free(d);
+}
+// string keys of many lengths keep their bytes straight as values move between slots
+static void string_keys(void){
+    int *d = NULL;
+    dict_init(d, .dense = true);
+    char key[40];
+    for (int k = 0; k < 2000; k++) { int n = sprintf(key, "%0*d", 1 + k % 30, k); dict_keystr_insert(d, key, k, n); }
+    for (int k = 0; k < 2000; k += 3) { int n = sprintf(key, "%0*d", 1 + k % 30, k); CHECK(dict_keystr_delete(d, key, n) >= 0); }
+    for (int k = 3000; k < 3500; k++) { int n = sprintf(key, "%0*d", 1 + k % 30, k); dict_keystr_insert(d, key, k, n); }
+    for (int k = 0; k < 3500; k++) {
+        if (k >= 2000 && k < 3000) continue;
+        int n = sprintf(key, "%0*d", 1 + k % 30, k);
+        DictIdx i = dict_keystr_get(d, key, n);
+        if (k < 2000 && k % 3 == 0) CHECK(i == -1);
+        else CHECK(i >= 0 && i < dict_count(d) && d[i] == k);
+    }
+    dict_free(d);
+}
+
+void test_dense(void){
+    packed_under_churn();
+    string_keys();
+}
@@ -0,0 +1,164 @@
+// Behavior every probing engine shares, run once per engine configuration: load factor, 
+// steady churn through tombstones, long collision chains, and a bounded key arena.
+#include <stdio.h>
+#include <string.h>
+#include "dict.h"
+#include "lib/darr.h"
+#include "test.h"
+
+static DictHash few_hashes(const void *key, size_t key_size, unsigned long long seed){
+    (void)key_size; (void)seed;
+    int k;
+    memcpy(&k, key, sizeof(k));
+    return (DictHash)(k % 8) * 0x9e3779b9u;
+}
+
+// the table fills to the engine's load factor, DICT_MAX_LOAD_NUM / DICT_MAX_LOAD_DEN, and no further
+static void load_factor(void){
+    int *d = NULL;
+    double fullest = 0;
+    for (int k = 0; k < 200000; k++) {
+        dict_insert(d, &k, k);
+        if (dict_cap(d) < 1024) continue;
+        double load = (double)dict_count(d) / (double)dict_cap(d);
+        if (load > fullest) fullest = load;
+    }
+    double max_load = (double)DICT_MAX_LOAD_NUM / DICT_MAX_LOAD_DEN;
+    CHECK(fullest <= max_load && fullest > max_load - 0.01);
+    dict_free(d);
+}
+// a window of live keys sliding over many more: deleted slots have to be reused or cleaned up 
+// by same-size rehashes, not piled up until the table doubles again and again
+static void churn(void){
+    enum { LIVE = 1000, STEPS = 300000 };
+    int *d = NULL;
+    for (int k = 0; k < LIVE; k++) dict_insert(d, &k, k);
+    DictIdx start_cap = dict_cap(d);
+    for (int k = LIVE; k < STEPS; k++) {
+        int old = k - LIVE;
+        CHECK(dict_delete(d, &old) >= 0);
+        CHECK(dict_insert(d, &k, k) >= 0);
+    }
+    CHECK(dict_count(d) == LIVE && dict_cap(d) <= start_cap * 2);
+    for (int k = 0; k < STEPS; k++) {
+        DictIdx i = dict_get(d, &k);
+        CHECK(k >= STEPS - LIVE ? i >= 0 && d[i] == k : i == -1);
+    }
+    dict_free(d);
+}
+// eight hashes for thousands of keys: long chains, deleted from in the middle and refilled
+static void collision_chains(void){
+    int *d = NULL;
+    dict_init(d, .hash_fn = few_hashes);
+    enum { KEYS = 2000 };
+    for (int k = 0; k < KEYS; k++) CHECK(dict_insert(d, &k, k) >= 0);
+    for (int round = 0; round < 3; round++) {
+        for (int k = round; k < KEYS; k += 3) CHECK(dict_delete(d, &k) >= 0);
+        for (int k = 0; k < KEYS; k++) {
+            DictIdx i = dict_get(d, &k);
+            CHECK((k % 3 == round) ? i == -1 : i >= 0 && d[i] == k);
+        }
+        for (int k = round; k < KEYS; k += 3) CHECK(dict_insert(d, &k, k) >= 0);
+    }
+    CHECK(dict_count(d) == KEYS);
+    dict_free(d);
+}
+
+#if defined(DICT_ROBIN_HOOD)
+// backward-shift deletion leaves no tombstones, and random churn keeps probe lengths short
+static void robin_hood_deletes(void){
+    enum { KEYS = 40000 };
+    static bool present[KEYS];
+    memset(present, 0, sizeof(present));
+    long long *d = NULL;
+    for (int it = 0; it < 200000; it++) {
+        long long k = (long long)(test_rand() % KEYS);
+        if (present[k]) CHECK(dict_delete(d, &k) >= 0);
+        else CHECK(dict_insert(d, &k, k) >= 0);
+        present[k] = !present[k];
+    }
+    DictStats st;
+    dict_stats(d, &st);
+    CHECK(st.tombstones == 0);
+    CHECK(st.hit_probes[DICT_PROBE_HIST - 1] < 10);
+    for (long long k = 0; k < KEYS; k++) CHECK((dict_get(d, &k) >= 0) == present[k]);
+    dict_free(d);
+}
+#endif
+
+#if defined(DICT_INCREMENTAL_GROW)
+// while the old array is being migrated, every key is found in one array or the other, and 
+// deletes and re-inserts of keys still in the old array take effect
+static void incremental_grow(void){
+    int *d = NULL;
+    int migrations = 0;
+    DictIdx migrating_cap = 0;
+    for (int k = 0; k < 100000; k++) {
+        CHECK(dict_insert(d, &k, k) >= 0);
+        DictHdr *h = dict__hdr(d);
+        if (!h->old_entries) continue;
+        if (h->old_cap != migrating_cap) migrations++;
+        migrating_cap = h->old_cap;
+        CHECK(h->migrate_pos < h->old_cap); // moved a few slots at a time, not all at once
+        int probe = (int)(test_rand() % (unsigned)(k + 1));
+        CHECK(d[dict_get(d, &probe)] == probe);
+        if (probe % 5 == 0 && probe != k) {
+            CHECK(dict_delete(d, &probe) >= 0);
+            CHECK(dict_get(d, &probe) == -1);
+            CHECK(dict_insert(d, &probe, probe) >= 0);
+        }
+    }
+    CHECK(migrations > 5);
+    for (int k = 0; k < 100000; k++) CHECK(d[dict_get(d, &k)] == k);
+    CHECK(dict_count(d) == 100000);
+    dict_free(d);
+}
+#endif
+
+static const char key_fill[] = "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx";
+
+// A table held at a steady size is rarely or never rehashed (Robin Hood and Swiss deletes leave 
+// little to rehash for, and an incremental grow never compacts), so the key arena has to be 
+// compacted without waiting for one.
+static void key_arena_churn(void){
+    enum { LIVE = 1000 };
+    int *d = NULL;
+    char key[80];
+    int ids[LIVE];
+    int next = 0;
+    for (int j = 0; j < LIVE; j++) {
+        ids[j] = next++;
+        dict_keystr_insert(d, key, ids[j], snprintf(key, sizeof(key), "%d-%.*s", ids[j], ids[j] % 60, key_fill));
+    }
+    for (int round = 0; round < 100000; round++) {
+        int j = (int)(test_rand() % LIVE);
+        int n = snprintf(key, sizeof(key), "%d-%.*s", ids[j], ids[j] % 60, key_fill);
+        CHECK(dict_keystr_delete(d, key, n) >= 0);
+        ids[j] = next++;
+        dict_keystr_insert(d, key, ids[j], snprintf(key, sizeof(key), "%d-%.*s", ids[j], ids[j] % 60, key_fill));
+    }
+    DictHdr *h = dict__hdr(d);
+    long long live_bytes = 0;
+    for (int j = 0; j < LIVE; j++) {
+        int n = snprintf(key, sizeof(key), "%d-%.*s", ids[j], ids[j] % 60, key_fill);
+        DictIdx i = dict_keystr_get(d, key, n);
+        CHECK(i >= 0 && d[i] == ids[j]);
+        live_bytes += n;
+    }
+    CHECK(h->key_bytes == live_bytes);
+    CHECK(darr_len(h->key_arena) <= 2 * live_bytes + h->cap + 80);
+    dict_free(d);
+}
+
+void test_engines(void){
+    load_factor();
+    churn();
+    collision_chains();
+    key_arena_churn();
+#if defined(DICT_ROBIN_HOOD)
+    robin_hood_deletes();
+#endif
+#if defined(DICT_INCREMENTAL_GROW)
+    incremental_grow();
+#endif
+}
@@ -0,0 +1,74 @@
+// The built in hash for each key size, seeds, and user supplied hash functions.
+#include <string.h>
+#include "dict.h"
+#include "test.h"
+
+typedef struct { long long a, b; } Key16;
+typedef struct { char b[3]; } Key3;
+typedef struct { long long a, b, c; } Key24;
+
+static int hash_calls;
+static DictHash counting_hash(const void *key, size_t key_size, unsigned long long seed){
+    hash_calls++;
+    return dict_hash_murmur2(key, key_size, seed);
+}
+
+// fills a dict with keys of one size (1 to 24 bytes, the mixers and wyhash) built from 'n' values
+#define CHECK_KEY_TYPE(T, n, make) do { \
+    int *d = NULL; \
+    for (int v = 0; v < (n); v++) { T key; memset(&key, 0, sizeof(key)); make; CHECK(dict_insert(d, &key, v) >= 0); } \
+    for (int v = 0; v < (n); v++) { T key; memset(&key, 0, sizeof(key)); make; CHECK(d[dict_get(d, &key)] == v); } \
+    CHECK(dict_count(d) == (n)); \
+    dict_free(d); \
+} while (0)
+
+static void key_sizes(void){
+    CHECK_KEY_TYPE(unsigned char, 256, key = (unsigned char)v);
+    CHECK_KEY_TYPE(short, 5000, key = (short)v);
+    CHECK_KEY_TYPE(int, 5000, key = v * 7919);
+    CHECK_KEY_TYPE(long long, 5000, key = (long long)v << 40);
+    CHECK_KEY_TYPE(Key16, 5000, key.b = v); // differs only in the second word
+    CHECK_KEY_TYPE(Key16, 5000, key.a = v);
+    CHECK_KEY_TYPE(Key3, 5000, memcpy(key.b, &v, 3));
+    CHECK_KEY_TYPE(Key24, 5000, key.c = v);
+}
+static void seeds(void){
+    long long key = 12345;
+    CHECK(dict__hash_seeded(&key, sizeof(key), 1) != dict__hash_seeded(&key, sizeof(key), 2));
+    char text[] = "a string key that takes the byte hash";
+    CHECK(dict__hash_seeded(text, sizeof(text), 1) != dict__hash_seeded(text, sizeof(text), 2));
+    int *a = NULL, *b = NULL, *c = NULL;
+    dict_init(a, .seed = 42);
+    dict_init(b, .random_seed = true);
+    dict_init(c, .random_seed = true);
+    CHECK(dict__hdr(a)->seed == 42);
+    CHECK(dict__hdr(b)->seed != dict__hdr(c)->seed);
+    for (int k = 0; k < 3000; k++) { dict_insert(a, &k, k); dict_insert(b, &k, k); }
+    for (int k = 0; k < 3000; k++) CHECK(a[dict_get(a, &k)] == k && b[dict_get(b, &k)] == k);
+    dict_free(a);
+    dict_free(b);
+    dict_free(c);
+}
+static void custom_hash(void){
+    int *d = NULL;
+    dict_init(d, .hash_fn = counting_hash, .seed = 7);
+    hash_calls = 0;
+    for (int k = 0; k < 1000; k++) dict_insert(d, &k, k);
+    CHECK(hash_calls >= 1000);
+    for (int k = 0; k < 1000; k++) CHECK(d[dict_get(d, &k)] == k);
+    char name[] = "murmur";
+    CHECK(dict_keystr_insert(d, name, -1, strlen(name)) >= 0);
+    CHECK(d[dict_keystr_get(d, name, strlen(name))] == -1);
+    dict_free(d);
+    int *m = NULL;
+    dict_init(m, .hash_fn = dict_hash_murmur2);
+    for (int k = 0; k < 1000; k++) dict_insert(m, &k, k);
+    for (int k = 0; k < 1000; k++) CHECK(m[dict_get(m, &k)] == k);
+    dict_free(m);
+}
+
+void test_hash(void){
+    key_sizes();
+    seeds();
+    custom_hash();
+}
@@ -0,0 +1,111 @@
+// dict_init options: presizing, load factor, alignment and allocators.
+#include <stdint.h>
+#include <string.h>
+#include "dict.h"
+#include "test.h"
+
+typedef struct { double v[8]; } Wide;
+
+// an allocator that counts what it hands out, to check every block comes back with its size
+typedef struct { long long blocks; long long bytes; } Counts;
+static void *counting_alloc(void *ctx, size_t size){
+    Counts *c = ctx;
+    c->blocks++;
+    c->bytes += (long long)size;
+    return malloc(size);
+}
+static void *counting_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size){
+    Counts *c = ctx;
+    if (!ptr) return counting_alloc(ctx, new_size);
+    c->bytes += (long long)new_size - (long long)old_size;
+    return realloc(ptr, new_size);
+}
+static void counting_free(void *ctx, void *ptr, size_t size){
+    Counts *c = ctx;
+    c->blocks--;
+    c->bytes -= (long long)size;
+    free(ptr);
+}
+
+static void initial_capacity(void){
+    long long *d = NULL;
+    dict_init(d, .initial_capacity = 100000);
+    DictIdx cap = dict_cap(d);
+    for (long long k = 0; k < 100000; k++) dict_insert(d, &k, k);
+    CHECK(dict_cap(d) == cap); // no grow on the way
+    for (long long k = 0; k < 100000; k++) CHECK(d[dict_get(d, &k)] == k);
+    dict_free(d);
+}
+static void max_load_factor(void){
+    int *d = NULL;
+    dict_init(d, .max_load_factor = 0.9f);
+    for (int k = 0; k < 57; k++) dict_insert(d, &k, k);
+    CHECK(dict_cap(d) == 64); // 57 of 64 is past every engine's default
+    for (int k = 57; k < 5000; k++) dict_insert(d, &k, k);
+    for (int k = 0; k < 5000; k++) CHECK(d[dict_get(d, &k)] == k);
+    dict_free(d);
+}
+static void alignment(void){
+    for (int align = 1; align <= 128; align *= 2) {
+        Wide *w = NULL;
+        dict_init(w, .alignment = align);
+        for (int k = 0; k < 3000; k++) {
+            Wide v = {{k}};
+            dict_insert(w, &k, v);
+            CHECK(((uintptr_t)w & (uintptr_t)(align < 16 ? 15 : align - 1)) == 0);
+        }
+        for (int k = 0; k < 3000; k++) CHECK(w[dict_get(w, &k)].v[0] == k);
+        dict_free(w);
+    }
+}
+static void counting_allocator(void){
+    Counts counts = {0};
+    Allocator a = {counting_alloc, counting_realloc, counting_free, &counts};
+    int *d = NULL;
+    dict_init(d, .allocator = &a);
+    char key[32];
+    for (int k = 0; k < 20000; k++) {
+        int n = snprintf(key, sizeof(key), "key %d", k);
+        dict_keystr_insert(d, key, k, n);
+    }
+    for (int k = 0; k < 20000; k += 2) {
+        int n = snprintf(key, sizeof(key), "key %d", k);
+        dict_keystr_delete(d, key, n);
+    }
+    CHECK(counts.blocks > 0);
+    dict_free(d);
+    CHECK(counts.blocks == 0 && counts.bytes == 0);
+}
+static void arena_allocator_reset(void){
+    Arena arena = {0};
+    arena.chunk_size = 4096;
+    Allocator a = arena_allocator(&arena);
+    for (int round = 0; round < 3; round++) {
+        int *ds[20] = {0};
+        char key[16];
+        for (int j = 0; j < 20; j++) {
+            dict_init(ds[j], .allocator = &a, .alignment = 64);
+            for (int k = 0; k < 300 + j; k++) {
+                int n = snprintf(key, sizeof(key), "k%d", k);
+                dict_keystr_insert(ds[j], key, k * j, n);
+            }
+        }
+        for (int j = 0; j < 20; j++) {
+            for (int k = 0; k < 300 + j; k++) {
+                int n = snprintf(key, sizeof(key), "k%d", k);
+                CHECK(ds[j][dict_keystr_get(ds[j], key, n)] == k * j);
+            }
+        }
+        if (round == 1) for (int j = 0; j < 20; j++) dict_free(ds[j]); // freeing into an arena is allowed too
+        arena_reset(&arena);
+    }
+    arena_free(&arena);
+}
+
+void test_init(void){
+    initial_capacity();
+    max_load_factor();
+    alignment();
+    counting_allocator();
+    arena_allocator_reset();
+}
@@ -0,0 +1,64 @@
+// dict_foreach and dict_next_live, including deleting the current value inside the loop.
+#include <string.h>
+#include "dict.h"
+#include "test.h"
+
+#define KEYS 20000
+
+static void visits_live_values(bool dense){
+    static bool present[KEYS];
+    memset(present, 0, sizeof(present));
+    int *d = NULL;
+    dict_init(d, .dense = dense);
+    for (int it = 0; it < 100000; it++) {
+        int k = (int)(test_rand() % KEYS);
+        if (test_rand() % 2) { dict_insert(d, &k, k); present[k] = true; }
+        else { dict_delete(d, &k); present[k] = false; }
+    }
+    DictIdx count = 0, prev = -1;
+    dict_foreach(d, i) {
+        CHECK(i > prev);
+        prev = i;
+        CHECK(present[d[i]] && dict_get(d, &d[i]) == i);
+        count++;
+    }
+    CHECK(count == dict_count(d));
+    dict_free(d);
+}
+// the case from review: 100 keys, the even ones deleted from inside the loop
+static void delete_current(bool dense){
+    int *d = NULL;
+    dict_init(d, .dense = dense);
+    for (int k = 0; k < 100; k++) dict_insert(d, &k, k);
+    int visits = 0;
+    dict_foreach(d, i) {
+        int k = d[i];
+        visits++;
+        if (k % 2 == 0) CHECK(dict_delete(d, &k) >= 0);
+    }
+    CHECK(visits == 100 && dict_count(d) == 50);
+    for (int k = 0; k < 100; k++) CHECK((dict_get(d, &k) >= 0) == (k % 2 == 1));
+    // and everything, which in a dense dict keeps pulling the last value into slot 0
+    visits = 0;
+    dict_foreach(d, i) {
+        int k = d[i];
+        visits++;
+        CHECK(dict_delete(d, &k) >= 0);
+    }
+    CHECK(visits == 50 && dict_count(d) == 0);
+    DictIdx left = 0;
+    dict_foreach(d, i) left++;
+    CHECK(left == 0);
+    dict_free(d);
+}
+
+void test_iter(void){
+    visits_live_values(false);
+    visits_live_values(true);
+    delete_current(false);
+    delete_current(true);
+    int *empty = NULL;
+    int n = 0;
+    dict_foreach(empty, i) n++;
+    CHECK(n == 0 && dict_next_live(empty, 0) == -1);
+}
@@ -0,0 +1,120 @@
+// Stored keys: keys that share a hash stay separate, and every key size compares correctly.
+#include <string.h>
+#include "dict.h"
+#include "lib/darr.h"
+#include "test.h"
+
+static DictHash same_hash(const void *key, size_t key_size, unsigned long long seed){
+    (void)key; (void)key_size; (void)seed;
+    return 7;
+}
+
+// entries used to match on the hash alone, so the second key overwrote the first
+static void two_colliding_keys(void){
+    long long *d = NULL;
+    dict_init(d, .hash_fn = same_hash);
+    long long a = 1, b = 2;
+    DictIdx ia = dict_insert(d, &a, 100);
+    DictIdx ib = dict_insert(d, &b, 200);
+    CHECK(ia >= 0 && ib >= 0 && ia != ib);
+    CHECK(dict_count(d) == 2);
+    CHECK(d[dict_get(d, &a)] == 100 && d[dict_get(d, &b)] == 200);
+    CHECK(dict_insert(d, &b, 300) == -1); // already there
+    CHECK(dict_delete(d, &a) == ia);
+    CHECK(dict_get(d, &a) == -1 && d[dict_get(d, &b)] == 200);
+    CHECK(dict_delete(d, &b) == ib);
+    CHECK(dict_get(d, &b) == -1 && dict_count(d) == 0);
+    dict_free(d);
+}
+static void many_colliding_keys(void){
+    int *d = NULL;
+    dict_init(d, .hash_fn = same_hash);
+    for (int k = 0; k < 3000; k++) CHECK(dict_insert(d, &k, k) >= 0);
+    for (int k = 0; k < 3000; k += 2) CHECK(dict_delete(d, &k) >= 0);
+    for (int k = 0; k < 3000; k++) {
+        DictIdx i = dict_get(d, &k);
+        CHECK(k % 2 ? i >= 0 && d[i] == k : i == -1);
+    }
+    for (int k = 0; k < 3000; k += 2) CHECK(dict_insert(d, &k, -k) >= 0); // reuses the freed slots
+    for (int k = 0; k < 3000; k++) CHECK(d[dict_get(d, &k)] == (k % 2 ? k : -k));
+    dict_free(d);
+}
+static void string_keys(void){
+    int *d = NULL;
+    char buf[64];
+    for (int k = 0; k < 20000; k++) {
+        int n = sprintf(buf, "key-%d-%s", k, k % 3 ? "x" : "with a longer tail");
+        CHECK(dict_keystr_insert(d, buf, k, n) >= 0);
+    }
+    for (int k = 0; k < 20000; k += 2) {
+        int n = sprintf(buf, "key-%d-%s", k, k % 3 ? "x" : "with a longer tail");
+        CHECK(dict_keystr_delete(d, buf, n) >= 0);
+    }
+    for (int k = 0; k < 20000; k++) {
+        int n = sprintf(buf, "key-%d-%s", k, k % 3 ? "x" : "with a longer tail");
+        DictIdx i = dict_keystr_get(d, buf, n);
+        CHECK(k % 2 ? i >= 0 && d[i] == k : i == -1);
+    }
+    // a key and its prefixes are different keys
+    char same[100];
+    memset(same, 'a', sizeof(same));
+    for (int n = 0; n < 100; n++) CHECK(dict_keystr_insert(d, same, n, n) >= 0);
+    for (int n = 0; n < 100; n++) CHECK(d[dict_keystr_get(d, same, n)] == n);
+    dict_clear(d);
+    CHECK(dict_count(d) == 0 && dict_keystr_get(d, same, 5) == -1);
+    dict_free(d);
+}
+// checks a dict against a plain array under random inserts, gets and deletes
+static void random_ops(void){
+    enum { KEYS = 50000 };
+    static bool present[KEYS];
+    memset(present, 0, sizeof(present));
+    long long *d = NULL;
+    for (int it = 0; it < 200000; it++) {
+        long long k = (long long)(test_rand() % KEYS);
+        int op = (int)(test_rand() % 3);
+        if (op == 0) {
+            DictIdx i = dict_insert(d, &k, k * 7);
+            CHECK(present[k] ? i == -1 : i >= 0 && d[i] == k * 7);
+            present[k] = true;
+        } else if (op == 1) {
+            DictIdx i = dict_get(d, &k);
+            CHECK(present[k] ? i >= 0 && d[i] == k * 7 : i == -1);
+        } else {
+            CHECK((dict_delete(d, &k) >= 0) == present[k]);
+            present[k] = false;
+        }
+    }
+    DictIdx count = 0;
+    for (long long k = 0; k < KEYS; k++) {
+        long long *p = dict_get_ptr(d, &k);
+        CHECK((p != NULL) == present[k] && (!p || *p == k * 7));
+        count += present[k];
+    }
+    CHECK(count == dict_count(d));
+    dict_free(d);
+}
+
+// a recycled slot keeps the bytes reserved for its longest key, so alternating lengths don't append
+static void alternating_key_lengths(void){
+    int *d = NULL;
+    dict_init(d, .initial_capacity = 64); // past small mode, which rebuilds its arena when full
+    char key[100];
+    memset(key, 'k', sizeof(key));
+    for (int i = 0; i < 10000; i++) {
+        int len = i % 2 ? 5 : 100;
+        key[0] = (char)i;
+        dict_keystr_insert(d, key, i, len);
+        CHECK(dict_keystr_delete(d, key, len) >= 0);
+    }
+    CHECK(darr_len(dict__hdr(d)->key_arena) <= 100);
+    dict_free(d);
+}
+
+void test_keys(void){
+    two_colliding_keys();
+    many_colliding_keys();
+    string_keys();
+    random_ops();
+    alternating_key_lengths();
+}
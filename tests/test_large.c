@@ -0,0 +1,83 @@
+// DictIdx / DictHash widths, the overflow checks on sizes, and the default allocator's mapped blocks.
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include "dict.h"
+#include "lib/darr.h"
+#include "test.h"
+
+// keys that only differ above bit 31 of their hash
+static DictHash high_hash(const void *key, size_t key_size, unsigned long long seed){
+    (void)key_size; (void)seed;
+    unsigned long long k;
+    memcpy(&k, key, sizeof(k));
+    return (DictHash)(k << 32);
+}
+static void hash_width(void){
+#if defined(DICT_LARGE)
+    CHECK(sizeof(DictIdx) == 8 && sizeof(DictHash) == 8 && DICT_HASH_BITS == 64);
+#else
+    CHECK(sizeof(DictIdx) == sizeof(int) && DICT_HASH_BITS == 32);
+#endif
+    // the home slot comes from the top bits, so with 64-bit hashes these spread over the table, 
+    // and with 32-bit ones they all collide and the key comparison keeps them apart
+    long long *d = NULL;
+    dict_init(d, .hash_fn = high_hash);
+    for (long long k = 0; k < 2000; k++) CHECK(dict_insert(d, &k, k * 5) >= 0);
+    for (long long k = 0; k < 2000; k++) CHECK(d[dict_get(d, &k)] == k * 5);
+    DictStats st;
+    dict_stats(d, &st);
+#if defined(DICT_LARGE)
+    CHECK(st.hit_probes[DICT_PROBE_HIST - 1] < 100);
+#endif
+    dict_free(d);
+}
+
+static void too_large_init(void){
+    int *d = NULL;
+    dict_init(d, .initial_capacity = DICT_IDX_MAX);
+}
+static void too_large_build(void){
+    struct { long long a, b; } key = {1, 2};
+    int *d = NULL;
+    dict_build_from_arrays(d, &key, NULL, DICT_IDX_MAX, 1); // never reads past key: the size is rejected first
+}
+static void too_large_darr(void){
+    long long *a = NULL;
+    darr_fit(a, PTRDIFF_MAX / 4);
+}
+
+// grows a block of the default allocator across ALLOCATOR_MAP_MIN and back, checking its bytes survive
+static void map_growth(void){
+    size_t min = ALLOCATOR_MAP_MIN && ALLOCATOR_MAP_MIN <= (1 << 20) ? (size_t)ALLOCATOR_MAP_MIN : 4096;
+    size_t sizes[] = {min / 2, min * 3, min * 7 + 100, min * 40, min * 5, min / 4};
+    size_t size = 16;
+    unsigned char *p = allocator_alloc(NULL, size);
+    for (size_t i = 0; i < size; i++) p[i] = (unsigned char)(i * 131 + 7);
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t keep = size < sizes[s] ? size : sizes[s];
+        p = allocator_realloc(NULL, p, size, sizes[s]);
+        for (size_t i = 0; i < keep; i++) CHECK(p[i] == (unsigned char)(i * 131 + 7));
+        size = sizes[s];
+        for (size_t i = keep; i < size; i++) p[i] = (unsigned char)(i * 131 + 7);
+    }
+    allocator_free(NULL, p, size);
+    // a dict whose arrays all pass the threshold
+    long long *d = NULL;
+    for (long long k = 0; k < 50000; k++) dict_insert(d, &k, -k);
+    for (long long k = 0; k < 50000; k += 2) dict_delete(d, &k);
+    dict_shrink_to_fit(d);
+    for (long long k = 0; k < 50000; k++) {
+        DictIdx i = dict_get(d, &k);
+        CHECK(k % 2 ? d[i] == -k : i == -1);
+    }
+    dict_free(d);
+}
+
+void test_large(void){
+    hash_width();
+    test_expect_exit(too_large_init);
+    test_expect_exit(too_large_build);
+    test_expect_exit(too_large_darr);
+    map_growth();
+}
@@ -0,0 +1,79 @@
+#include <string.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+#if defined(__SANITIZE_ADDRESS__)
+#include <sanitizer/lsan_interface.h>
+#endif
+#include "test.h"
+
+static const struct { const char *name; void (*run)(void); } tests[] = {
+    {"large", test_large},
+    {"iter", test_iter},
+    {"keys", test_keys},
+    {"capacity", test_capacity},
+    {"engines", test_engines},
+    {"hash", test_hash},
+    {"batch", test_batch},
+    {"concurrent", test_concurrent},
+    {"init", test_init},
+    {"dense", test_dense},
+    {"snapshot", test_snapshot},
+    {"stats", test_stats},
+    {"shrink", test_shrink},
+    {"small", test_small},
+    {"upsert", test_upsert},
+    {"build", test_build},
+};
+
+static unsigned long long rng_state = 0x9e3779b97f4a7c15ull;
+unsigned long long test_rand(void){
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+void test_expect_exit(void (*fn)(void)){
+#if defined(__unix__) || defined(__APPLE__)
+    fflush(NULL);
+    pid_t pid = fork();
+    CHECK(pid >= 0);
+    if (pid == 0) {
+#if defined(__SANITIZE_ADDRESS__)
+        __lsan_disable(); // whatever fn had allocated when it gave up is not a leak worth reporting
+#endif
+        if (!freopen("/dev/null", "w", stderr)) _exit(3);
+        fn();
+        _exit(0);
+    }
+    int status;
+    CHECK(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 1);
+#else
+    (void)fn;
+#endif
+}
+void test_temp_path(char *path, size_t size, const char *suffix){
+#if defined(__unix__) || defined(__APPLE__)
+    snprintf(path, size, "dict_test_%d.%s", (int)getpid(), suffix);
+#else
+    snprintf(path, size, "dict_test.%s", suffix);
+#endif
+}
+
+// usage: dict_tests [name]. Runs every test, or the one named.
+int main(int argc, char **argv){
+    int ran = 0;
+    for (size_t t = 0; t < sizeof(tests) / sizeof(tests[0]); t++) {
+        if (argc > 1 && strcmp(argv[1], tests[t].name) != 0) continue;
+        tests[t].run();
+        printf("ok %s\n", tests[t].name);
+        ran++;
+    }
+    if (!ran) {
+        fprintf(stderr, "no test named %s\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}
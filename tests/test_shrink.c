@@ -0,0 +1,147 @@
+// dict_shrink_to_fit, automatic shrinking and dict_compact.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dict.h"
+#include "test.h"
+
+typedef struct { long long k, v; } Pair;
+#define KEYS 20000
+static bool present[KEYS];
+
+static void check_contents(Pair *d){
+    DictIdx count = 0;
+    for (long long k = 0; k < KEYS; k++) {
+        DictIdx i = dict_get(d, &k);
+        if (present[k]) { CHECK(i >= 0 && d[i].k == k && d[i].v == k * 3); count++; }
+        else CHECK(i == -1);
+    }
+    CHECK(count == dict_count(d));
+    DictIdx seen = 0;
+    dict_foreach(d, i) { CHECK(present[d[i].k]); seen++; }
+    CHECK(seen == count);
+}
+static void fill_and_drain(bool dense, float shrink){
+    Pair *d = NULL;
+    if (dense || shrink > 0) dict_init(d, .dense = dense, .shrink_load_factor = shrink);
+    memset(present, 0, sizeof(present));
+    for (int round = 0; round < 4; round++) {
+        for (long long k = 0; k < KEYS; k++) {
+            if (present[k] || test_rand() % 4 == 0) continue;
+            dict_insert(d, &k, ((Pair){k, k * 3}));
+            present[k] = true;
+        }
+        check_contents(d);
+        DictIdx peak = dict_cap(d);
+        for (long long k = 0; k < KEYS; k++) {
+            if (!present[k] || test_rand() % 100 >= 97) continue;
+            dict_delete(d, &k);
+            present[k] = false;
+        }
+        if (round % 2 == 0) {
+            DictIdx range = dict_range(d);
+            DictIdx *remap = malloc(sizeof(DictIdx) * (size_t)(range + 1));
+            Pair *before = malloc(sizeof(Pair) * (size_t)(range + 1));
+            memcpy(before, d, sizeof(Pair) * (size_t)range);
+            dict_compact(d, remap);
+            CHECK(dict_range(d) == dict_count(d));
+            for (DictIdx i = 0; i < range; i++) if (remap[i] >= 0) CHECK(d[remap[i]].k == before[i].k);
+            free(remap);
+            free(before);
+        }
+        dict_shrink_to_fit(d);
+        CHECK(dict_cap(d) < peak);
+        check_contents(d);
+        for (long long k = 0; k < 10; k++) { // with shrink_load_factor, these inserts may shrink it
+            if (present[k]) continue;
+            dict_insert(d, &k, ((Pair){k, k * 3}));
+            present[k] = true;
+        }
+        check_contents(d);
+    }
+    dict_clear(d);
+    memset(present, 0, sizeof(present));
+    dict_shrink_to_fit(d);
+    CHECK(dict_cap(d) <= INITIAL_CAPACITY);
+    check_contents(d);
+    dict_free(d);
+}
+// the live count falling below shrink_load_factor * cap shrinks the table on the next insert; the
+// survivors sit at the start of the data array, so they don't pin the capacity
+static void automatic_shrink(void){
+    int *d = NULL;
+    dict_init(d, .shrink_load_factor = 0.1f);
+    for (int k = 0; k < 50000; k++) dict_insert(d, &k, k);
+    DictIdx peak = dict_cap(d);
+    for (int k = 1000; k < 50000; k++) dict_delete(d, &k);
+    CHECK(dict_cap(d) == peak); // deletes don't move anything
+    int k = -1;
+    dict_insert(d, &k, k);
+    CHECK(dict_cap(d) < peak);
+    for (k = -1; k < 50000; k++) {
+        DictIdx i = dict_get(d, &k);
+        CHECK(k >= 1000 ? i == -1 : i >= 0 && d[i] == k);
+    }
+    dict_free(d);
+}
+static int key_str(char *key, int k){
+    return snprintf(key, 64, "key-%d-%.*s", k, k % 30, "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxx");
+}
+static void string_keys(void){
+    int *d = NULL;
+    dict_init(d, .shrink_load_factor = 0.05f);
+    char key[64];
+    for (int round = 0; round < 3; round++) {
+        for (int k = 0; k < 5000; k++) dict_keystr_insert(d, key, k, key_str(key, k));
+        for (int k = 0; k < 5000; k++) if (k % 50) CHECK(dict_keystr_delete(d, key, key_str(key, k)) >= 0);
+        dict_compact(d, NULL);
+        dict_shrink_to_fit(d);
+        for (int k = 0; k < 5000; k++) {
+            DictIdx i = dict_keystr_get(d, key, key_str(key, k));
+            CHECK(k % 50 ? i == -1 : i >= 0 && d[i] == k);
+        }
+        for (int k = 0; k < 5000; k += 50) dict_keystr_delete(d, key, key_str(key, k));
+        CHECK(dict_count(d) == 0);
+    }
+    dict_free(d);
+}
+
+// A table already at its smallest capacity, with no tombstones (Robin Hood), isn't rehashed, but its 
+// key arena may still hold the bytes of deleted keys the churn didn't reuse
+static void arena_after_churn(bool dense){
+    enum { LIVE = 1000 };
+    int *d = NULL;
+    dict_init(d, .dense = dense);
+    char key[64];
+    int ids[LIVE];
+    for (int j = 0; j < LIVE; j++) ids[j] = j, dict_keystr_insert(d, key, j, key_str(key, j));
+    for (int round = 0, next = LIVE; round < 50000; round++) {
+        int j = (int)(test_rand() % LIVE);
+        CHECK(dict_keystr_delete(d, key, key_str(key, ids[j])) >= 0);
+        ids[j] = next++;
+        dict_keystr_insert(d, key, ids[j], key_str(key, ids[j]));
+    }
+    dict_shrink_to_fit(d);
+    size_t live_bytes = 0;
+    for (int j = 0; j < LIVE; j++) {
+        int n = key_str(key, ids[j]);
+        DictIdx i = dict_keystr_get(d, key, n);
+        CHECK(i >= 0 && d[i] == ids[j]);
+        live_bytes += (size_t)n;
+    }
+    DictStats st;
+    dict_stats(d, &st);
+    CHECK(st.key_arena_bytes <= live_bytes + 128); // the darr header and alignment
+    dict_free(d);
+}
+
+void test_shrink(void){
+    fill_and_drain(false, 0);
+    fill_and_drain(true, 0);
+    fill_and_drain(false, 0.1f);
+    fill_and_drain(true, 0.1f);
+    automatic_shrink();
+    string_keys();
+    arena_after_churn(false);
+    arena_after_churn(true);
+}
@@ -0,0 +1,148 @@
+// Small mode: dicts of up to DICT_SMALL_CAP keys, and the one-way switch to a hash table past that.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dict.h"
+#include "dict_snapshot.h"
+#include "lib/allocator.h"
+#include "test.h"
+
+typedef struct { long long k, v; } Pair;
+#define KEYS 40
+static bool present[KEYS];
+
+static void check_contents(Pair *d){
+    DictIdx count = 0;
+    for (long long k = 0; k < KEYS; k++) {
+        DictIdx i = dict_get(d, &k);
+        if (present[k]) { CHECK(i >= 0 && d[i].k == k && d[i].v == k * 3); count++; }
+        else CHECK(i == -1);
+    }
+    CHECK(count == dict_count(d));
+    DictIdx seen = 0;
+    dict_foreach(d, i) { CHECK(present[d[i].k]); seen++; }
+    CHECK(seen == count);
+    long long keys[KEYS];
+    DictIdx out[KEYS];
+    for (int k = 0; k < KEYS; k++) keys[k] = k;
+    dict_get_many(d, keys, KEYS, out);
+    for (int k = 0; k < KEYS; k++) CHECK((out[k] >= 0) == present[k]);
+}
+static void set(Pair **d, long long k, bool on){
+    if (on) CHECK((dict_insert(*d, &k, ((Pair){k, k * 3})) >= 0) == !present[k]);
+    else CHECK((dict_delete(*d, &k) >= 0) == present[k]);
+    present[k] = on;
+}
+// maxkey 18 keeps the count around DICT_SMALL_CAP: the dict switches to a hash table the first time
+// the count passes it, and stays hashed as the count drops back below
+static void churn(bool dense, const Allocator *a, int maxkey){
+    Pair *d = NULL;
+    if (dense || a) dict_init(d, .dense = dense, .allocator = a);
+    memset(present, 0, sizeof(present));
+    for (int it = 0; it < 4000; it++) {
+        set(&d, (long long)(test_rand() % (unsigned)maxkey), test_rand() % 2);
+        if (it % 97 == 0) check_contents(d);
+    }
+    check_contents(d);
+    dict_compact(d, NULL);
+    check_contents(d);
+    dict_clear(d);
+    memset(present, 0, sizeof(present));
+    check_contents(d);
+    dict_free(d);
+}
+static void stays_small(const char *path){
+    Pair *d = NULL;
+    memset(present, 0, sizeof(present));
+    for (long long k = 0; k < DICT_SMALL_CAP; k++) set(&d, k, true);
+    CHECK(dict__hdr(d)->small);
+    check_contents(d);
+    CHECK(dict_save(d, path));
+    Pair *m = dict_mmap_open(path);
+    CHECK(m && dict__hdr(m)->small);
+    check_contents(m);
+    set(&m, DICT_SMALL_CAP, true); // grows out of the mapping into a hash table
+    CHECK(!dict__hdr(m)->small);
+    check_contents(m);
+    dict_free(m);
+    present[DICT_SMALL_CAP] = false;
+    m = dict_mmap_open(path);
+    set(&m, 3, false);
+    set(&m, 20, true);
+    check_contents(m);
+    dict_free(m);
+    present[3] = true;
+    present[20] = false;
+    set(&d, DICT_SMALL_CAP, true);
+    CHECK(!dict__hdr(d)->small);
+    check_contents(d);
+    dict_free(d);
+}
+// keys longer than DICT_SMALL_KEY_BYTES in total move the key bytes out of the small block
+static void long_keys(void){
+    enum { NAMES = 20 };
+    char **d = NULL;
+    char buf[300];
+    char *names[NAMES] = {0};
+    for (int it = 0; it < 20000; it++) {
+        int j = (int)(test_rand() % NAMES);
+        if (names[j]) {
+            CHECK(dict_keystr_delete(d, names[j], strlen(names[j])) >= 0);
+            free(names[j]);
+            names[j] = NULL;
+        } else {
+            int len = snprintf(buf, sizeof(buf), "%d-", j);
+            int extra = (int)(test_rand() % 250);
+            memset(buf + len, 'x', (size_t)extra);
+            len += extra;
+            buf[len] = 0;
+            DictIdx r = dict_keystr_insert(d, buf, NULL, len);
+            CHECK(r >= 0);
+            names[j] = strdup(buf);
+            d[r] = names[j];
+        }
+        if (it % 50) continue;
+        for (int x = 0; x < NAMES; x++) {
+            if (!names[x]) continue;
+            DictIdx r = dict_keystr_get(d, names[x], strlen(names[x]));
+            CHECK(r >= 0 && d[r] == names[x]);
+        }
+    }
+    for (int x = 0; x < NAMES; x++) free(names[x]);
+    dict_free(d);
+}
+static void insert_many_into_empty(void){
+    long long keys[KEYS];
+    Pair vals[KEYS];
+    for (int i = 0; i < KEYS; i++) keys[i] = i, vals[i] = (Pair){i, i * 3};
+    for (int n = 10; n <= KEYS; n += KEYS - 10) {
+        Pair *d = NULL;
+        memset(present, 0, sizeof(present));
+        for (int i = 0; i < n; i++) present[i] = true;
+        dict_insert_many(d, keys, vals, n, NULL);
+        CHECK(dict__hdr(d)->small == (n <= DICT_SMALL_CAP));
+        check_contents(d);
+        dict_shrink_to_fit(d);
+        check_contents(d);
+        dict_free(d);
+    }
+}
+
+void test_small(void){
+    char path[64];
+    test_temp_path(path, sizeof(path), "snapshot");
+    stays_small(path);
+    remove(path);
+    long_keys();
+    churn(false, NULL, 18);
+    churn(true, NULL, 18);
+    churn(false, NULL, KEYS);
+    churn(true, NULL, KEYS);
+    Arena arena = {0};
+    arena.chunk_size = 4096;
+    Allocator a = arena_allocator(&arena);
+    churn(false, &a, 20);
+    churn(true, &a, 20);
+    arena_free(&arena);
+    insert_many_into_empty();
+}
@@ -0,0 +1,104 @@
+// dict_save / dict_mmap_open: round trips, updates to a mapped dict, and rejected files.
+#include <string.h>
+#include "dict.h"
+#include "dict_snapshot.h"
+#include "test.h"
+
+typedef struct { long long a; int b; } Value;
+
+static DictHash own_hash(const void *key, size_t key_size, unsigned long long seed){
+    return dict_hash_murmur2(key, key_size, seed) ^ 1;
+}
+static void flip_byte(const char *path, long offset){
+    FILE *f = fopen(path, "r+b");
+    CHECK(f);
+    CHECK(fseek(f, offset, SEEK_SET) == 0);
+    int c = fgetc(f);
+    CHECK(fseek(f, offset, SEEK_SET) == 0);
+    fputc(c ^ 1, f);
+    fclose(f);
+}
+
+static void round_trip(const char *path, int mode){
+    enum { N = 20000 };
+    Value *d = NULL;
+    if (mode == 1) dict_init(d, .dense = true);
+    if (mode == 2) dict_init(d, .hash_fn = dict_hash_murmur2, .alignment = 64);
+    if (mode == 3) dict_init(d, .random_seed = true);
+    for (long long k = 0; k < N; k++) dict_insert(d, &k, ((Value){k * 2, (int)k}));
+    for (long long k = 0; k < N; k += 3) dict_delete(d, &k);
+    char key[32];
+    for (int k = 0; k < 1000; k++) { int n = sprintf(key, "str%d", k); dict_keystr_insert(d, key, ((Value){k, -k}), n); }
+    CHECK(dict_save(d, path));
+
+    Value *m = dict_mmap_open(path);
+    CHECK(m);
+    CHECK(dict_count(m) == dict_count(d) && dict_range(m) == dict_range(d));
+    for (long long k = 0; k < N; k++) {
+        DictIdx i = dict_get(m, &k);
+        CHECK(k % 3 == 0 ? i == -1 : i >= 0 && m[i].a == k * 2 && i == dict_get(d, &k));
+    }
+    for (int k = 0; k < 1000; k++) {
+        int n = sprintf(key, "str%d", k);
+        DictIdx i = dict_keystr_get(m, key, n);
+        CHECK(i >= 0 && m[i].b == -k);
+    }
+    DictIdx seen = 0;
+    dict_foreach(m, i) seen++;
+    CHECK(seen == dict_count(m));
+    // updates in place, then enough inserts to grow out of the mapping
+    for (long long k = 0; k < N; k += 3) dict_insert(m, &k, ((Value){k * 2, (int)k}));
+    for (long long k = N; k < 3 * N; k++) dict_insert(m, &k, ((Value){k * 2, (int)k}));
+    for (long long k = 0; k < 3 * N; k++) { DictIdx i = dict_get(m, &k); CHECK(i >= 0 && m[i].a == k * 2); }
+    for (long long k = 0; k < N; k++) dict_delete(m, &k);
+    CHECK(dict_count(m) == 2 * N + 1000);
+    dict_free(m);
+
+    m = dict_mmap_open(path); // the file was not changed by any of that
+    CHECK(m && dict_count(m) == dict_count(d));
+    dict_free(m);
+    dict_free(d);
+
+    flip_byte(path, 5000); // body checksum
+    CHECK(dict_mmap_open(path) == NULL);
+    flip_byte(path, 5000);
+    flip_byte(path, 8); // header
+    CHECK(dict_mmap_open(path) == NULL);
+}
+static void small_and_empty(const char *path){
+    int *d = NULL;
+    for (int k = 0; k < 10; k++) dict_insert(d, &k, k);
+    CHECK(dict_save(d, path));
+    int *m = dict_mmap_open(path);
+    CHECK(m && dict_count(m) == 10);
+    for (int k = 10; k < 100; k++) dict_insert(m, &k, k); // grows out of the small layout
+    for (int k = 0; k < 100; k++) CHECK(m[dict_get(m, &k)] == k);
+    dict_free(m);
+    dict_clear(d);
+    CHECK(dict_save(d, path));
+    m = dict_mmap_open(path);
+    CHECK(m && dict_count(m) == 0);
+    int k = 1;
+    dict_insert(m, &k, 5);
+    CHECK(m[dict_get(m, &k)] == 5);
+    dict_free(m);
+    dict_free(d);
+}
+static void rejected(const char *path){
+    CHECK(dict_mmap_open("no such snapshot file") == NULL);
+    int *d = NULL;
+    dict_init(d, .hash_fn = own_hash);
+    int k = 1;
+    dict_insert(d, &k, 1);
+    CHECK(!dict_save(d, path)); // a function pointer can't be saved
+    dict_free(d);
+}
+
+void test_snapshot(void){
+    char path[64];
+    test_temp_path(path, sizeof(path), "snapshot");
+    for (int mode = 0; mode < 4; mode++) round_trip(path, mode);
+    small_and_empty(path);
+    rejected(path);
+    remove(path);
+}
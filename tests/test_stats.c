@@ -0,0 +1,52 @@
+// dict_stats, and the DICT_PROBE_COUNTERS counts when that is defined.
+#include "dict.h"
+#include "test.h"
+
+static DictHash same_hash(const void *key, size_t key_size, unsigned long long seed){
+    (void)key; (void)key_size; (void)seed;
+    return 7;
+}
+static DictIdx histogram_total(const DictIdx *h){
+    DictIdx total = 0;
+    for (int i = 0; i < DICT_PROBE_HIST; i++) total += h[i];
+    return total;
+}
+
+static void counts_and_histograms(void){
+    DictStats st;
+    int *d = NULL;
+    dict_stats(d, &st);
+    CHECK(st.cap == 0 && st.len == 0);
+    for (long long k = 0; k < 100000; k++) dict_insert(d, &k, (int)k);
+    for (long long k = 0; k < 100000; k += 3) dict_delete(d, &k);
+    for (long long k = 0; k < 200000; k++) dict_get(d, &k);
+    dict_stats(d, &st);
+    CHECK(st.len == dict_count(d) && st.cap == dict_cap(d));
+    CHECK(histogram_total(st.hit_probes) == st.len); // one count per live key
+    CHECK(histogram_total(st.miss_probes) > 0);
+    CHECK(st.free_list_len + st.len == dict_range(d));
+    CHECK(st.load_factor >= (float)st.len / (float)st.cap && st.load_factor <= st.max_load_factor);
+    CHECK(st.rehashes > 0);
+    CHECK(st.entries_bytes >= (size_t)st.cap * sizeof(DictEntry) && st.data_bytes >= (size_t)dict_range(d) * sizeof(int));
+    CHECK(st.key_arena_bytes >= (size_t)st.len * sizeof(long long));
+#if defined(DICT_PROBE_COUNTERS)
+    CHECK(st.probes.lookups >= 200000 && st.probes.lookup_probes >= st.probes.lookups);
+#endif
+    dict_free(d);
+}
+// every key shares one hash, so hit probes spread past the home slot (group of up to 32 for DICT_SWISS)
+static void bad_hash_shows(void){
+    DictStats st;
+    int *d = NULL;
+    dict_init(d, .hash_fn = same_hash);
+    for (int k = 0; k < 100; k++) dict_insert(d, &k, k);
+    dict_stats(d, &st);
+    CHECK(st.len == 100 && histogram_total(st.hit_probes) == 100);
+    CHECK(st.hit_probes[0] <= 32 && st.hit_probes[3] > 0);
+    dict_free(d);
+}
+
+void test_stats(void){
+    counts_and_histograms();
+    bad_hash_shows();
+}
@@ -0,0 +1,73 @@
+// dict_upsert and dict_get_or_set_default, checked against a counting model.
+#include <stdio.h>
+#include <string.h>
+#include "dict.h"
+#include "test.h"
+
+#define KEYS 5000
+
+static void counts(bool dense){
+    static int model[KEYS];
+    int *d = NULL;
+    if (dense) dict_init(d, .dense = true);
+    memset(model, 0, sizeof(model));
+    for (int it = 0; it < 200000; it++) {
+        long long k = (long long)(test_rand() % (it < 100000 ? 20 : KEYS)); // small mode first
+        int op = (int)(test_rand() % 10);
+        if (op < 4) {
+            bool added;
+            DictIdx i = dict_upsert(d, &k, &added);
+            CHECK(added == (model[k] == 0));
+            if (added) d[i] = 0;
+            d[i]++;
+            model[k]++;
+        } else if (op < 8) {
+            (*dict_get_or_set_default(d, &k, 0))++;
+            model[k]++;
+        } else if (op < 9) {
+            CHECK((dict_delete(d, &k) >= 0) == (model[k] > 0));
+            model[k] = 0;
+        } else {
+            DictIdx i = dict_get(d, &k);
+            CHECK(model[k] ? i >= 0 && d[i] == model[k] : i == -1);
+        }
+    }
+    for (long long k = 0; k < KEYS; k++) {
+        DictIdx i = dict_get(d, &k);
+        CHECK(model[k] ? i >= 0 && d[i] == model[k] : i == -1);
+    }
+    dict_free(d);
+}
+static void word_counts(void){
+    static const char *words[] = {"the", "a", "quick", "brown", "fox", "jumps", "over", "the", "lazy", "dog", "a", "fox"};
+    int *d = NULL;
+    char key[64];
+    for (int r = 0; r < 100; r++) {
+        for (int j = 0; j < 12; j++) {
+            int n = snprintf(key, sizeof(key), "%s%d", words[j], r % 7);
+            if (j % 2) {
+                bool added;
+                DictIdx i = dict_keystr_upsert(d, key, n, &added);
+                if (added) d[i] = 0;
+                d[i]++;
+            } else {
+                (*dict_keystr_get_or_set_default(d, key, n, 0))++;
+            }
+        }
+    }
+    int total = 0;
+    dict_foreach(d, i) total += d[i];
+    CHECK(total == 1200);
+    CHECK(dict_count(d) == 9 * 7);
+    DictIdx i = dict_keystr_get(d, "the3", 4);
+    CHECK(i >= 0 && d[i] == 28); // r % 7 == 3 for 14 rounds, "the" twice per round
+    CHECK(dict_keystr_upsert(d, "the3", 4, NULL) == i); // the added flag is optional
+    CHECK(dict_count(d) == 9 * 7);
+    dict_free(d);
+}
+
+void test_upsert(void){
+    counts(false);
+    counts(true);
+    word_counts();
+}